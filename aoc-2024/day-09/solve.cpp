@@ -1,23 +1,45 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cinttypes>
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <optional>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 
-constexpr int16_t kEmptyItem = -1;
+constexpr int32_t kEmptyItem = -1;
+constexpr size_t kMaxFileSize = 9;
 constexpr bool kDebug = false;
 
+typedef unsigned __int128 wide_checksum_t;
+
+// Sum of block indices in [idx, idx + size).
+inline uint64_t index_sum(const uint64_t idx, const uint64_t size) {
+    return (idx + (idx + size - 1)) * size / 2;
+}
+
 class Disk {
 public:
     explicit Disk(std::string &input) {
-        std::vector buffer(input.length() * 9, kEmptyItem);
         std::vector<std::pair<size_t, size_t> > block_pos_sizes;
         std::vector<std::pair<size_t, size_t> > free_pos_sizes;
         block_pos_sizes.reserve(input.length() / 2 + 1);
         free_pos_sizes.reserve(input.length() / 2 + 1);
 
         bool is_free = true;
-        int16_t block_id = 0;
+        int32_t block_id = 0;
         size_t offset = 0;
         for (const char &c: input) {
             // filter invalid characters
@@ -28,7 +50,6 @@ public:
             is_free = !is_free;
             size_t block_len = static_cast<size_t>(c) - '0';
             if (!is_free) {
-                std::fill_n(buffer.begin() + static_cast<int>(offset), block_len, block_id);
                 block_pos_sizes.emplace_back(offset, block_len);
                 block_id++;
             } else {
@@ -36,10 +57,9 @@ public:
             }
             offset += block_len;
         }
-        buffer.resize(offset);
 
-        max_block_id_ = static_cast<int16_t>(block_id - 1);
-        data_ = std::move(buffer);
+        max_block_id_ = block_id - 1;
+        disk_size_ = offset;
         pos_data_ = std::move(block_pos_sizes);
         free_data_ = std::move(free_pos_sizes);
     }
@@ -47,6 +67,7 @@ public:
     Disk(const Disk &other) = default;
 
     uint64_t checksum() {
+        expand_mut();
         uint64_t checksum = 0;
         uint64_t idx = 0;
         for (auto it = data_.begin(); it != data_.end(); ++it, ++idx) {
@@ -62,11 +83,214 @@ public:
         uint64_t blk_id = 0;
         for (auto it = pos_data_.cbegin(); it != pos_data_.cend(); ++it, ++blk_id) {
             const auto &[idx, size] = *it;
-            checksum += blk_id * ((idx + (idx + size - 1)) * size / 2);
+            checksum += blk_id * index_sum(idx, size);
         }
         return checksum;
     }
 
+    // v1 checksum straight from the run-length spans: a front cursor keeps files in place, while a back
+    // cursor pours the tail files into the free span following each front file.
+    [[nodiscard]] uint64_t checksum_v1() const {
+        if (pos_data_.empty()) {
+            return 0;
+        }
+
+        uint64_t checksum = 0;
+        size_t pos = 0;
+        size_t front = 0;
+        size_t back = pos_data_.size() - 1;
+        size_t back_remaining = pos_data_[back].second;
+        while (front <= back) {
+            const auto front_size = front == back ? back_remaining : pos_data_[front].second;
+            checksum += front * index_sum(pos, front_size);
+            pos += front_size;
+
+            size_t free_size = front < free_data_.size() ? free_data_[front].second : 0;
+            while (free_size > 0 && front < back) {
+                const auto moved = std::min(free_size, back_remaining);
+                checksum += back * index_sum(pos, moved);
+                pos += moved;
+                free_size -= moved;
+                back_remaining -= moved;
+                if (back_remaining == 0) {
+                    back_remaining = pos_data_[--back].second;
+                }
+            }
+            ++front;
+        }
+        return checksum;
+    }
+
+    // v1 checksum split across threads. With `F` file blocks in total, compaction fills exactly [0, F): blocks
+    // left of `F` stay, and the k-th free block left of `F` receives the k-th file block counted from the right.
+    // Per-file block ranks (prefix sums of file sizes) let every chunk place its own blocks independently.
+    [[nodiscard]] uint64_t checksum_v1_parallel(const size_t thread_count) const {
+        const size_t files = pos_data_.size();
+        if (files == 0) {
+            return 0;
+        }
+
+        const size_t chunk_count = std::clamp<size_t>(thread_count, 1, files);
+        const size_t chunk_size = (files + chunk_count - 1) / chunk_count;
+        auto run_chunks = [&](auto &&callback) {
+            std::vector<std::thread> workers{};
+            workers.reserve(chunk_count);
+            for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+                const auto first = std::min(files, chunk * chunk_size);
+                const auto last = std::min(files, first + chunk_size);
+                workers.emplace_back(callback, chunk, first, last);
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        };
+
+        // file_rank[i]: number of file blocks before file `i`.
+        std::vector<uint64_t> file_rank(files + 1, 0);
+        std::vector<uint64_t> chunk_offset(chunk_count + 1, 0);
+        run_chunks([&](const size_t chunk, const size_t first, const size_t last) {
+            uint64_t sum = 0;
+            for (size_t i = first; i < last; i++) {
+                sum += pos_data_[i].second;
+                file_rank[i + 1] = sum;
+            }
+            chunk_offset[chunk + 1] = sum;
+        });
+        for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+            chunk_offset[chunk + 1] += chunk_offset[chunk];
+        }
+        run_chunks([&](const size_t chunk, const size_t first, const size_t last) {
+            for (size_t i = first; i < last; i++) {
+                file_rank[i + 1] += chunk_offset[chunk];
+            }
+        });
+
+        const uint64_t total = file_rank[files];
+        std::vector<uint64_t> chunk_checksum(chunk_count, 0);
+        run_chunks([&](const size_t chunk, const size_t first, const size_t last) {
+            uint64_t checksum = 0;
+            for (size_t i = first; i < last; i++) {
+                const auto &[blk_idx, blk_size] = pos_data_[i];
+                if (blk_idx >= total) {
+                    break;
+                }
+                checksum += i * index_sum(blk_idx, std::min<uint64_t>(blk_size, total - blk_idx));
+
+                if (i >= free_data_.size()) {
+                    continue;
+                }
+                const auto &[free_idx, free_size] = free_data_[i];
+                if (free_idx >= total) {
+                    continue;
+                }
+
+                // Free blocks before this span, which is also the rank of its first filler counted from the right.
+                const uint64_t free_rank = free_idx - file_rank[i + 1];
+                uint64_t fill = std::min<uint64_t>(free_size, total - free_idx);
+                uint64_t pos = free_idx;
+                uint64_t rank = total - 1 - free_rank;
+                auto file = static_cast<size_t>(std::ranges::upper_bound(file_rank, rank) - file_rank.begin() - 1);
+                while (fill > 0) {
+                    const auto moved = std::min(fill, rank - file_rank[file] + 1);
+                    checksum += file * index_sum(pos, moved);
+                    pos += moved;
+                    fill -= moved;
+                    rank -= moved;
+                    while (fill > 0 && rank < file_rank[file]) {
+                        --file;
+                    }
+                }
+            }
+            chunk_checksum[chunk] = checksum;
+        });
+
+        uint64_t checksum = 0;
+        for (const auto value: chunk_checksum) {
+            checksum += value;
+        }
+        return checksum;
+    }
+
+    // Edits keep every other file where it is, like on a real disk: new files go to the end, deleted files leave
+    // free space behind, and a file can only grow into the free span right after it (or past the end of the disk
+    // when it is the last file). Files hold at most `kMaxFileSize` blocks. Each edit only touches the file and its
+    // neighbouring free span. The compacted checksums are not patched per edit: the next query recomputes them in
+    // full, see `query_checksum_v1`.
+    std::optional<size_t> append_file(const size_t size, const size_t gap = 0) {
+        if (size > kMaxFileSize) {
+            return std::nullopt;
+        }
+
+        const size_t id = pos_data_.size();
+        const size_t blk_idx = id == 0 ? disk_size_ : disk_size_ + gap;
+        if (id > 0) {
+            if (free_data_.size() < id) {
+                free_data_.emplace_back(disk_size_, 0);
+            }
+            free_data_.back().second += gap;
+        }
+
+        pos_data_.emplace_back(blk_idx, size);
+        disk_size_ = blk_idx + size;
+        max_block_id_ = static_cast<int32_t>(id);
+        invalidate();
+        return id;
+    }
+
+    bool delete_file(const size_t id) {
+        return resize_file(id, 0);
+    }
+
+    bool resize_file(const size_t id, const size_t size) {
+        if (id >= pos_data_.size() || size > kMaxFileSize) {
+            return false;
+        }
+
+        auto &[blk_idx, blk_size] = pos_data_[id];
+        const bool is_last = id + 1 == pos_data_.size();
+        if (id >= free_data_.size()) {
+            free_data_.emplace_back(blk_idx + blk_size, 0);
+        }
+
+        auto &[free_idx, free_size] = free_data_[id];
+        if (size > blk_size + free_size && !is_last) {
+            return false;
+        }
+
+        const auto free_end = free_idx + free_size;
+        blk_size = size;
+        free_idx = blk_idx + blk_size;
+        free_size = free_end > free_idx ? free_end - free_idx : 0;
+        disk_size_ = std::max(disk_size_, free_idx + free_size);
+        invalidate();
+        return true;
+    }
+
+    // Compacted checksums for the current layout. Each one is a full pass over the spans (v1 `O(n)`, v2
+    // `O(n log n)`), run on the first query after edits and cached until the next edit. An edit changes the number
+    // of file blocks, which re-pairs every block v1 moves, and can move every later file in v2, so neither is
+    // updated in place.
+    uint64_t query_checksum_v1() {
+        if (!cached_v1_) {
+            cached_v1_ = checksum_v1();
+        }
+        return *cached_v1_;
+    }
+
+    uint64_t query_checksum_v2() {
+        if (!cached_v2_) {
+            // Start from the checksum of the layout as is, then move every file that moves.
+            uint64_t checksum = checksum_v2();
+            auto free_spans = free_data_;
+            place_v2(free_spans, [&](const size_t id, const size_t new_idx) {
+                const auto &[blk_idx, blk_size] = pos_data_[id];
+                checksum += id * index_sum(new_idx, blk_size) - id * index_sum(blk_idx, blk_size);
+            });
+            cached_v2_ = checksum;
+        }
+        return *cached_v2_;
+    }
+
     [[nodiscard]] Disk compact_v1() const {
         Disk disk(*this);
         disk.compact_v1_mut();
@@ -80,6 +304,7 @@ public:
     }
 
     void compact_v1_mut() {
+        expand_mut();
         auto left = data_.begin();
         auto right = data_.rbegin();
         while (left < right.base()) {
@@ -98,7 +323,7 @@ public:
 
     void print_pos_data() const {
         if constexpr (kDebug) {
-            std::string buffer(data_.size(), '.');
+            std::string buffer(disk_size_, '.');
             uint16_t blk_id = 0;
             for (auto &[blk_idx, blk_size]: pos_data_) {
                 for (int i = 0; i < blk_size; i++) {
@@ -111,6 +336,16 @@ public:
     }
 
     void compact_v2_mut() {
+        print_pos_data();
+        place_v2(free_data_, [&](const size_t id, const size_t new_idx) {
+            pos_data_[id].first = new_idx;
+            print_pos_data();
+        });
+    }
+
+    // Reference implementation: rescans free spans from the left for every block, O(blocks * spans).
+    void compact_v2_scan_mut() {
+        merge_adjacent_spans(free_data_);
         print_pos_data();
         for (auto it = pos_data_.rbegin(); it != pos_data_.rend(); ++it) {
             auto &[blk_idx, blk_size] = *it;
@@ -137,13 +372,530 @@ public:
     }
 
 private:
-    int16_t max_block_id_{-1};
-    std::vector<int16_t> data_{};
+    // v2 placement: one min-heap of free span indices per span size (spans of `kMaxFileSize` or more share the
+    // last heap, as they fit every file). Spans never move past the next span, so the smallest index is also the
+    // leftmost span, and the leftmost fit is the smallest top of the heaps that are large enough for the file.
+    // `on_move(id, new_idx)` is called for every file that moves.
+    template<typename T>
+    void place_v2(std::vector<std::pair<size_t, size_t> > &free_spans, T &&on_move) const {
+        merge_adjacent_spans(free_spans);
+        auto bucket_of = [](const size_t free_size) { return std::min(free_size, kMaxFileSize); };
+        std::array<std::priority_queue<size_t, std::vector<size_t>, std::greater<> >, kMaxFileSize + 1>
+                free_by_size{};
+        for (size_t i = 0; i < free_spans.size(); i++) {
+            if (const auto free_size = free_spans[i].second; free_size > 0) {
+                free_by_size[bucket_of(free_size)].push(i);
+            }
+        }
+
+        for (size_t id = pos_data_.size(); id-- > 0;) {
+            const auto &[blk_idx, blk_size] = pos_data_[id];
+            if (blk_size == 0) {
+                continue;
+            }
+
+            size_t best_size = 0;
+            size_t best_span = SIZE_MAX;
+            for (size_t size = blk_size; size < free_by_size.size(); size++) {
+                if (!free_by_size[size].empty() && free_by_size[size].top() < best_span) {
+                    best_span = free_by_size[size].top();
+                    best_size = size;
+                }
+            }
+
+            if (best_size == 0 || free_spans[best_span].first >= blk_idx) {
+                continue;
+            }
+
+            free_by_size[best_size].pop();
+            auto &[free_idx, free_size] = free_spans[best_span];
+            const auto new_idx = free_idx;
+            free_idx += blk_size;
+            free_size -= blk_size;
+            if (free_size > 0) {
+                free_by_size[bucket_of(free_size)].push(best_span);
+            }
+            on_move(id, new_idx);
+        }
+    }
+
+    // A deleted (or emptied) file leaves its free span right after the previous one. Whole files need the free
+    // blocks as one span, so each run of adjacent spans is merged into its first one, and the rest are left empty.
+    static void merge_adjacent_spans(std::vector<std::pair<size_t, size_t> > &free_spans) {
+        size_t run = 0;
+        for (size_t i = 1; i < free_spans.size(); i++) {
+            auto &[run_idx, run_size] = free_spans[run];
+            if (auto &[free_idx, free_size] = free_spans[i]; run_idx + run_size == free_idx) {
+                run_size += free_size;
+                free_size = 0;
+            } else {
+                run = i;
+            }
+        }
+    }
+
+    void invalidate() {
+        data_.clear();
+        cached_v1_.reset();
+        cached_v2_.reset();
+    }
+
+    // Materialise the per-block layout, only needed by the dense v1 compaction.
+    void expand_mut() {
+        if (!data_.empty() || disk_size_ == 0) {
+            return;
+        }
+
+        data_.assign(disk_size_, kEmptyItem);
+        int32_t block_id = 0;
+        for (const auto &[blk_idx, blk_size]: pos_data_) {
+            std::fill_n(data_.begin() + static_cast<int>(blk_idx), blk_size, block_id++);
+        }
+    }
+
+    int32_t max_block_id_{-1};
+    size_t disk_size_{0};
+    std::vector<int32_t> data_{};
+    std::optional<uint64_t> cached_v1_{};
+    std::optional<uint64_t> cached_v2_{};
     std::vector<std::pair<size_t, size_t> > pos_data_{};
     std::vector<std::pair<size_t, size_t> > free_data_{};
 };
 
+// Memory-mapped disk map for inputs too large to expand: file `id` is digit `2 * id`, and the free span
+// following it is digit `2 * id + 1`. Both checksums are computed by cursors walking the mapping.
+class DiskStream {
+public:
+    explicit DiskStream(const char *path) {
+        fd_ = open(path, O_RDONLY);
+        if (fd_ < 0) {
+            return;
+        }
+
+        struct stat st{};
+        if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+            return;
+        }
+
+        void *map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (map == MAP_FAILED) {
+            return;
+        }
+
+        data_ = static_cast<const char *>(map);
+        mapped_size_ = static_cast<size_t>(st.st_size);
+
+        // filter trailing new line
+        length_ = mapped_size_;
+        while (length_ > 0 && !isdigit(data_[length_ - 1])) {
+            length_--;
+        }
+    }
+
+    DiskStream(const DiskStream &other) = delete;
+    DiskStream &operator=(const DiskStream &other) = delete;
+
+    ~DiskStream() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char *>(data_), mapped_size_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    [[nodiscard]] bool is_open() const { return data_ != nullptr; }
+    [[nodiscard]] size_t file_count() const { return (length_ + 1) / 2; }
+    [[nodiscard]] uint8_t file_size(const size_t id) const { return data_[2 * id] - '0'; }
+
+    [[nodiscard]] uint8_t free_size(const size_t id) const {
+        return 2 * id + 1 < length_ ? static_cast<uint8_t>(data_[2 * id + 1] - '0') : 0;
+    }
+
+    // Same two cursor walk as `Disk::checksum_v1`, reading span sizes from the mapping.
+    [[nodiscard]] wide_checksum_t checksum_v1() const {
+        if (file_count() == 0) {
+            return 0;
+        }
+
+        wide_checksum_t checksum = 0;
+        uint64_t pos = 0;
+        size_t front = 0;
+        size_t back = file_count() - 1;
+        size_t back_remaining = file_size(back);
+        while (front <= back) {
+            const size_t front_size = front == back ? back_remaining : file_size(front);
+            checksum += static_cast<wide_checksum_t>(front) * index_sum(pos, front_size);
+            pos += front_size;
+
+            size_t free = free_size(front);
+            while (free > 0 && front < back) {
+                const auto moved = std::min(free, back_remaining);
+                checksum += static_cast<wide_checksum_t>(back) * index_sum(pos, moved);
+                pos += moved;
+                free -= moved;
+                back_remaining -= moved;
+                if (back_remaining == 0) {
+                    back_remaining = file_size(--back);
+                }
+            }
+            ++front;
+        }
+        return checksum;
+    }
+
+    // v2 keeps, for each block size, a cursor at the leftmost free span that can still hold it. Spans only
+    // shrink, so cursors only move right, and only the remaining sizes between the leftmost and the rightmost
+    // cursor need to be kept in memory (one byte per span).
+    [[nodiscard]] wide_checksum_t checksum_v2() const {
+        uint64_t disk_size = 0;
+        for (size_t i = 0; i < length_; i++) {
+            disk_size += static_cast<uint64_t>(data_[i] - '0');
+        }
+
+        std::deque<uint8_t> window{};
+        size_t window_begin = 0;
+        auto remaining = [&](const size_t span) -> uint8_t & {
+            while (span >= window_begin + window.size()) {
+                window.push_back(free_size(window_begin + window.size()));
+            }
+            return window[span - window_begin];
+        };
+
+        std::array<size_t, 10> cursor{};
+        std::array<uint64_t, 10> cursor_offset{};
+        cursor_offset.fill(file_count() > 0 ? file_size(0) : 0);
+        auto advance = [&](const uint8_t size, const size_t limit) {
+            auto &span = cursor[size];
+            while (span < limit && remaining(span) < size) {
+                cursor_offset[size] += free_size(span) + file_size(span + 1);
+                ++span;
+            }
+        };
+
+        wide_checksum_t checksum = 0;
+        uint64_t end = disk_size;
+        for (size_t id = file_count(); id-- > 0;) {
+            end -= free_size(id);
+            const uint8_t size = file_size(id);
+            const uint64_t file_offset = end - size;
+            end = file_offset;
+            if (size == 0) {
+                continue;
+            }
+
+            advance(size, id);
+            uint64_t target = file_offset;
+            if (const auto span = cursor[size]; span < id) {
+                auto &span_remaining = remaining(span);
+                target = cursor_offset[size] + free_size(span) - span_remaining;
+                span_remaining -= size;
+            }
+            checksum += static_cast<wide_checksum_t>(id) * index_sum(target, size);
+
+            // keep every cursor valid, so spans left of the smallest one can be dropped
+            for (uint8_t i = 1; i < cursor.size(); i++) {
+                advance(i, id);
+            }
+            while (window_begin < cursor[1] && !window.empty()) {
+                window.pop_front();
+                window_begin++;
+            }
+        }
+        return checksum;
+    }
+
+private:
+    int fd_{-1};
+    const char *data_{nullptr};
+    size_t mapped_size_{0};
+    size_t length_{0};
+};
+
+std::string to_string(wide_checksum_t value) {
+    std::string result{};
+    do {
+        result.push_back(static_cast<char>('0' + static_cast<int>(value % 10)));
+        value /= 10;
+    } while (value != 0);
+    std::ranges::reverse(result);
+    return result;
+}
+
+// Apply edits read from stdin to the disk, one per line:
+//   a <size> [gap]  append a file after `gap` free blocks
+//   d <id>          delete a file
+//   r <id> <size>   resize a file
+//   q               print both compacted checksums
+void serve_edits(Disk &disk) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream stream(line);
+        char command{};
+        size_t a{0}, b{0};
+        stream >> command >> a >> b;
+        switch (command) {
+            case 'a':
+                if (const auto id = disk.append_file(a, b)) {
+                    printf("file %zu\n", *id);
+                } else {
+                    printf("error: unable to append file of size %zu\n", a);
+                }
+                break;
+            case 'd':
+                if (!disk.delete_file(a)) {
+                    printf("error: invalid file %zu\n", a);
+                }
+                break;
+            case 'r':
+                if (!disk.resize_file(a, b)) {
+                    printf("error: unable to resize file %zu to %zu\n", a, b);
+                }
+                break;
+            case 'q':
+                printf("p1: %" PRIu64 "\n", disk.query_checksum_v1());
+                printf("p2: %" PRIu64 "\n", disk.query_checksum_v2());
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+std::string generate_disk_map(const size_t file_count, const uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> file_len(1, 9);
+    std::uniform_int_distribution<int> free_len(0, 9);
+
+    std::string result(file_count * 2 - 1, '0');
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i] = static_cast<char>('0' + (i % 2 == 0 ? file_len(rng) : free_len(rng)));
+    }
+    return result;
+}
+
+template<typename T>
+double time_ms(T &&callback) {
+    const auto start = std::chrono::steady_clock::now();
+    callback();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void run_benchmark() {
+    const size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    for (const size_t file_count: {10'000, 30'000, 200'000}) {
+        auto input = generate_disk_map(file_count, static_cast<uint32_t>(file_count));
+        const Disk disk(input);
+
+        Disk scan_disk(disk);
+        Disk index_disk(disk);
+        const auto scan_ms = time_ms([&] { scan_disk.compact_v2_scan_mut(); });
+        const auto index_ms = time_ms([&] { index_disk.compact_v2_mut(); });
+
+        uint64_t span_v1{0}, dense_v1{0}, parallel_v1{0};
+        const auto span_v1_ms = time_ms([&] { span_v1 = disk.checksum_v1(); });
+        const auto dense_v1_ms = time_ms([&] { dense_v1 = disk.compact_v1().checksum(); });
+        const auto parallel_v1_ms = time_ms([&] { parallel_v1 = disk.checksum_v1_parallel(thread_count); });
+        printf("bench: files=%zu, v1 dense=%.2fms, v1 spans=%.2fms, v1 parallel(%zu)=%.2fms, checksum %s (%" PRIu64
+               ")\n", file_count, dense_v1_ms, span_v1_ms, thread_count, parallel_v1_ms,
+               dense_v1 == span_v1 && span_v1 == parallel_v1 ? "ok" : "MISMATCH", span_v1);
+
+        const auto scan_checksum = scan_disk.checksum_v2();
+        const auto index_checksum = index_disk.checksum_v2();
+        printf("bench: files=%zu, scan=%.2fms, index=%.2fms, checksum %s (%" PRIu64 ")\n", file_count, scan_ms,
+               index_ms, scan_checksum == index_checksum ? "ok" : "MISMATCH", index_checksum);
+    }
+}
+
+// Reference for `--test`: the disk as one id per block (`kEmptyItem` when free), edited by the same rules as `Disk`
+// and compacted block by block. Files keep their start while empty, as that is where they grow back.
+class BlockLayout {
+public:
+    explicit BlockLayout(const std::string &input) {
+        bool is_free = true;
+        for (const char c: input) {
+            if (!isdigit(c)) {
+                continue;
+            }
+            is_free = !is_free;
+            const size_t size = static_cast<size_t>(c) - '0';
+            if (!is_free) {
+                starts_.push_back(blocks_.size());
+                sizes_.push_back(size);
+            }
+            blocks_.resize(blocks_.size() + size, is_free ? kEmptyItem : static_cast<int32_t>(sizes_.size() - 1));
+        }
+    }
+
+    [[nodiscard]] size_t file_count() const { return starts_.size(); }
+
+    std::optional<size_t> append_file(const size_t size, const size_t gap) {
+        if (size > kMaxFileSize) {
+            return std::nullopt;
+        }
+        const size_t id = starts_.size();
+        const size_t start = id == 0 ? blocks_.size() : blocks_.size() + gap;
+        starts_.push_back(start);
+        sizes_.push_back(size);
+        blocks_.resize(start, kEmptyItem);
+        blocks_.resize(start + size, static_cast<int32_t>(id));
+        return id;
+    }
+
+    bool resize_file(const size_t id, const size_t size) {
+        if (id >= starts_.size() || size > kMaxFileSize) {
+            return false;
+        }
+        const auto start = starts_[id];
+        if (id + 1 < starts_.size() && start + size > starts_[id + 1]) {
+            return false;
+        }
+        blocks_.resize(std::max(blocks_.size(), start + size), kEmptyItem);
+        std::fill_n(blocks_.begin() + static_cast<ptrdiff_t>(start), sizes_[id], kEmptyItem);
+        std::fill_n(blocks_.begin() + static_cast<ptrdiff_t>(start), size, static_cast<int32_t>(id));
+        sizes_[id] = size;
+        return true;
+    }
+
+    // Moves the last file block into the leftmost free block, until no free block is left of a file block.
+    [[nodiscard]] uint64_t checksum_v1() const {
+        auto blocks = blocks_;
+        size_t left = 0;
+        size_t right = blocks.size();
+        while (true) {
+            while (left < right && blocks[left] != kEmptyItem) {
+                left++;
+            }
+            while (left < right && blocks[right - 1] == kEmptyItem) {
+                right--;
+            }
+            if (left + 1 >= right) {
+                break;
+            }
+            std::swap(blocks[left], blocks[right - 1]);
+        }
+        return checksum_of(blocks);
+    }
+
+    // Moves every file (highest id first) into the leftmost run of free blocks left of it that can hold it.
+    [[nodiscard]] uint64_t checksum_v2() const {
+        auto blocks = blocks_;
+        for (size_t id = starts_.size(); id-- > 0;) {
+            const auto start = starts_[id];
+            const auto size = sizes_[id];
+            if (size == 0) {
+                continue;
+            }
+            size_t run = 0;
+            for (size_t i = 0; i < start; i++) {
+                run = blocks[i] == kEmptyItem ? run + 1 : 0;
+                if (run == size) {
+                    std::fill_n(blocks.begin() + static_cast<ptrdiff_t>(i + 1 - size), size, blocks[start]);
+                    std::fill_n(blocks.begin() + static_cast<ptrdiff_t>(start), size, kEmptyItem);
+                    break;
+                }
+            }
+        }
+        return checksum_of(blocks);
+    }
+
+private:
+    static uint64_t checksum_of(const std::vector<int32_t> &blocks) {
+        uint64_t checksum = 0;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (blocks[i] != kEmptyItem) {
+                checksum += i * static_cast<uint64_t>(blocks[i]);
+            }
+        }
+        return checksum;
+    }
+
+    std::vector<int32_t> blocks_{};
+    std::vector<size_t> starts_{};
+    std::vector<size_t> sizes_{};
+};
+
+// Random edits on small generated disks. After every edit, the edited `Disk` must give the same answers and
+// checksums as a `BlockLayout` edited the same way.
+bool run_tests() {
+    constexpr uint32_t kDisks = 300;
+    constexpr size_t kEdits = 40;
+
+    size_t mismatches = 0;
+    for (uint32_t seed = 0; seed < kDisks; seed++) {
+        std::mt19937 rng(seed);
+        // The first disk is the case where a deleted file's free span used to stay split from the previous one.
+        auto input = seed == 0 ? std::string("12345") : generate_disk_map(1 + rng() % 12, seed);
+        Disk disk(input);
+        BlockLayout layout(input);
+
+        for (size_t edit = 0; edit < kEdits; edit++) {
+            const size_t id = rng() % (layout.file_count() + 1);
+            const size_t size = rng() % (kMaxFileSize + 2);
+            char command;
+            bool same;
+            switch (rng() % 3) {
+                case 0:
+                    command = 'a';
+                    same = disk.append_file(size, id % 4) == layout.append_file(size, id % 4);
+                    break;
+                case 1:
+                    command = 'd';
+                    same = disk.delete_file(id) == layout.resize_file(id, 0);
+                    break;
+                default:
+                    command = 'r';
+                    same = disk.resize_file(id, size) == layout.resize_file(id, size);
+                    break;
+            }
+
+            same &= disk.query_checksum_v1() == layout.checksum_v1() &&
+                    disk.query_checksum_v2() == layout.checksum_v2();
+            if (!same) {
+                printf("test: disk %u (%s), edit %zu ('%c' %zu %zu): MISMATCH\n", seed, input.c_str(), edit, command,
+                       id, size);
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    printf("test: %u disks, %zu edits each: %s\n", kDisks, kEdits, mismatches == 0 ? "ok" : "MISMATCH");
+    return mismatches == 0;
+}
+
 int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_benchmark();
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--test") == 0) {
+        return run_tests() ? 0 : 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--edits") == 0) {
+        std::ifstream ifs(argc > 2 ? argv[2] : "sample.txt");
+        std::string input((std::istreambuf_iterator(ifs)), std::istreambuf_iterator<char>());
+        Disk disk(input);
+        serve_edits(disk);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--stream") == 0) {
+        const char *input_file_path = argc > 2 ? argv[2] : "sample.txt";
+        const DiskStream disk(input_file_path);
+        if (!disk.is_open()) {
+            printf("error: unable to map file %s\n", input_file_path);
+            return 1;
+        }
+
+        printf("p1: %s\n", to_string(disk.checksum_v1()).c_str());
+        printf("p2: %s\n", to_string(disk.checksum_v2()).c_str());
+        return 0;
+    }
+
     std::ifstream ifs(argc > 1 ? argv[1] : "sample.txt");
     ifs.seekg(0, std::ios::end);
     std::string input(ifs.tellg(), 0);
@@ -151,7 +903,8 @@ int main(int argc, char **argv) {
     ifs.read(input.data(), static_cast<std::streamsize>(input.size()));
 
     const Disk disk(input);
-    const auto p1 = disk.compact_v1().checksum();
+    const size_t thread_count = std::thread::hardware_concurrency();
+    const auto p1 = thread_count > 1 ? disk.checksum_v1_parallel(thread_count) : disk.checksum_v1();
     const auto p2 = disk.compact_v2().checksum_v2();
     printf("p1: %" PRIu64 "\n", p1);
     printf("p2: %" PRIu64 "\n", p2);
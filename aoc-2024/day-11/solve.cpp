@@ -1,22 +1,120 @@
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <bit>
+#include <chrono>
 #include <cinttypes>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <unordered_map>
+#include <thread>
 #include <vector>
-#include <ranges>
 
-void dict_add(std::unordered_map<int64_t, int64_t> &d, int64_t key, int64_t value) {
-    if (const auto it = d.find(key); it != d.end()) {
-        it->second += value;
-    } else {
-        d[key] = value;
+// kPow10[i] = 10^i, for every power that fits in a uint64_t.
+constexpr std::array<uint64_t, 20> kPow10 = [] {
+    std::array<uint64_t, 20> result{};
+    uint64_t value = 1;
+    for (auto &item: result) {
+        item = value;
+        value *= 10;
     }
+    return result;
+}();
+
+constexpr int digit_count(const uint64_t value) {
+    int digits = 1;
+    while (digits < static_cast<int>(kPow10.size()) && value >= kPow10[digits]) {
+        digits++;
+    }
+    return digits;
+}
+
+static_assert(digit_count(0) == 1);
+static_assert(digit_count(9) == 1);
+static_assert(digit_count(10) == 2);
+static_assert(digit_count(UINT64_MAX) == 20);
+
+// Flat open-addressing (linear probing) table of stone value -> count. Stone values are never negative,
+// so `kEmptyKey` marks free slots. Clearing keeps the allocation, so a table can be reused every blink.
+class StoneTable {
+public:
+    static constexpr int64_t kEmptyKey = -1;
+
+    struct entry_t {
+        int64_t key;
+        int64_t value;
+    };
+
+    // Clear the table, making sure it can hold `count` keys at a load factor of at most 1/2.
+    void reset(const size_t count) {
+        const auto capacity = std::bit_ceil(std::max<size_t>(16, count * 2));
+        if (capacity > slots_.size()) {
+            slots_.resize(capacity);
+        }
+        std::fill(slots_.begin(), slots_.end(), entry_t{kEmptyKey, 0});
+        mask_ = slots_.size() - 1;
+        size_ = 0;
+    }
+
+    int64_t &operator[](const int64_t key) {
+        if (size_ * 2 >= slots_.size()) {
+            grow();
+        }
+
+        for (size_t i = hash(key);; i = (i + 1) & mask_) {
+            auto &slot = slots_[i];
+            if (slot.key == key) {
+                return slot.value;
+            }
+            if (slot.key == kEmptyKey) {
+                slot.key = key;
+                size_++;
+                return slot.value;
+            }
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return size_; }
+
+    template<typename T>
+    void for_each(T &&callback) const {
+        for (const auto &[key, value]: slots_) {
+            if (key != kEmptyKey) {
+                callback(key, value);
+            }
+        }
+    }
+
+private:
+    [[nodiscard]] size_t hash(const int64_t key) const {
+        return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E37'79B9'7F4A'7C15ull) >> 32) & mask_;
+    }
+
+    void grow() {
+        auto old_slots = std::move(slots_);
+        slots_ = {};
+        reset(old_slots.size());
+        for (const auto &[key, value]: old_slots) {
+            if (key != kEmptyKey) {
+                (*this)[key] = value;
+            }
+        }
+    }
+
+    std::vector<entry_t> slots_{};
+    size_t mask_{0};
+    size_t size_{0};
+};
+
+inline void dict_add(StoneTable &d, const int64_t key, const int64_t value) {
+    d[key] += value;
 }
 
 class Stones {
 public:
     explicit Stones(const std::vector<int64_t> &from_vec) {
+        data_.reset(from_vec.size());
         for (const auto &value: from_vec) {
             add(value, 1);
         }
@@ -26,20 +124,42 @@ public:
         dict_add(data_, key, value);
     }
 
-    int64_t sum() const {
+    [[nodiscard]] int64_t sum() const {
         int64_t result{0};
-        for (const auto &value: std::views::values(data_)) {
-            result += value;
-        }
+        data_.for_each([&](int64_t, const int64_t count) { result += count; });
         return result;
     }
 
+    // Every stone turns into at most two, so the next generation never needs more than twice the keys.
     void blink() {
-        std::unordered_map<int64_t, int64_t> next_stones{};
-        for (auto &[value, count]: data_) {
+        auto &next_stones = next_;
+        next_stones.reset(data_.size() * 2);
+        data_.for_each([&](const int64_t value, const int64_t count) {
             if (value == 0) {
                 dict_add(next_stones, 1, count);
-                continue;
+                return;
+            }
+
+            if (const auto digits = digit_count(value); digits % 2 == 0) {
+                const auto half = static_cast<int64_t>(kPow10[digits / 2]);
+                dict_add(next_stones, value / half, count);
+                dict_add(next_stones, value % half, count);
+                return;
+            }
+
+            dict_add(next_stones, value * 2024, count);
+        });
+        std::swap(data_, next_);
+    }
+
+    // Reference implementation of `blink`, splitting numbers through their decimal string.
+    void blink_string() {
+        auto &next_stones = next_;
+        next_stones.reset(data_.size() * 2);
+        data_.for_each([&](const int64_t value, const int64_t count) {
+            if (value == 0) {
+                dict_add(next_stones, 1, count);
+                return;
             }
 
             auto value_str = std::to_string(value);
@@ -48,18 +168,216 @@ public:
 
                 dict_add(next_stones, stoll(value_str.substr(0, mid)), count);
                 dict_add(next_stones, stoll(value_str.substr(mid)), count);
-                continue;
+                return;
             }
 
             dict_add(next_stones, value * 2024, count);
+        });
+        std::swap(data_, next_);
+    }
+
+private:
+    // `data_` holds the current generation, `next_` is the buffer the next blink writes into.
+    StoneTable data_{};
+    StoneTable next_{};
+};
+
+// Stones split by a stable hash of their value into one shard per worker thread. In a blink, each worker turns
+// its own shard into per-destination outboxes, then (after a barrier) merges every outbox addressed to its shard
+// into it. Workers only ever write to their own shard and outboxes, so no locks are needed.
+class ShardedStones {
+public:
+    ShardedStones(const std::vector<int64_t> &from_vec, const size_t shard_count)
+        : shards_(std::max<size_t>(1, shard_count)),
+          outboxes_(shards_.size(), std::vector<std::vector<StoneTable::entry_t> >(shards_.size())) {
+        for (auto &shard: shards_) {
+            shard.reset(from_vec.size() / shards_.size());
+        }
+        for (const auto &value: from_vec) {
+            dict_add(shards_[shard_of(value)], value, 1);
         }
-        data_ = std::move(next_stones);
+    }
+
+    [[nodiscard]] int64_t sum() const {
+        int64_t result{0};
+        for (const auto &shard: shards_) {
+            shard.for_each([&](int64_t, const int64_t count) { result += count; });
+        }
+        return result;
+    }
+
+    void blink(const size_t times) {
+        std::barrier sync(static_cast<std::ptrdiff_t>(shards_.size()));
+        auto worker = [&](const size_t id) {
+            auto &shard = shards_[id];
+            auto &outbox = outboxes_[id];
+            for (size_t blink = 0; blink < times; blink++) {
+                for (auto &items: outbox) {
+                    items.clear();
+                }
+                auto emit = [&](const int64_t value, const int64_t count) {
+                    outbox[shard_of(value)].push_back({value, count});
+                };
+                shard.for_each([&](const int64_t value, const int64_t count) {
+                    if (value == 0) {
+                        emit(1, count);
+                    } else if (const auto digits = digit_count(value); digits % 2 == 0) {
+                        const auto half = static_cast<int64_t>(kPow10[digits / 2]);
+                        emit(value / half, count);
+                        emit(value % half, count);
+                    } else {
+                        emit(value * 2024, count);
+                    }
+                });
+                sync.arrive_and_wait();
+
+                size_t incoming = 0;
+                for (const auto &from: outboxes_) {
+                    incoming += from[id].size();
+                }
+                shard.reset(incoming);
+                for (const auto &from: outboxes_) {
+                    for (const auto &[value, count]: from[id]) {
+                        dict_add(shard, value, count);
+                    }
+                }
+                sync.arrive_and_wait();
+            }
+        };
+
+        std::vector<std::thread> workers{};
+        for (size_t id = 1; id < shards_.size(); id++) {
+            workers.emplace_back(worker, id);
+        }
+        worker(0);
+        for (auto &thread: workers) {
+            thread.join();
+        }
+    }
+
+private:
+    // Different multiplier from `StoneTable`'s hash, so keys of one shard still spread over its table.
+    [[nodiscard]] size_t shard_of(const int64_t value) const {
+        return static_cast<size_t>((static_cast<uint64_t>(value) * 0xD6E8'FEB8'6659'FD93ull) >> 32) % shards_.size();
+    }
+
+    std::vector<StoneTable> shards_{};
+    // outboxes_[from][to]: stones produced by worker `from` for shard `to` during the current blink.
+    std::vector<std::vector<std::vector<StoneTable::entry_t> > > outboxes_{};
+};
+
+typedef unsigned __int128 count_t;
+
+// Once the set of distinct stone values stops growing, every blink applies the same linear map to the vector of
+// stone counts. StoneGraph discovers that closed set once, together with the (one or two) values each one turns
+// into, and then only moves counts along those edges.
+class StoneGraph {
+public:
+    static constexpr uint32_t kNoChild = UINT32_MAX;
+
+    explicit StoneGraph(const std::vector<int64_t> &from_vec) {
+        StoneTable index_of{};
+        index_of.reset(from_vec.size());
+        auto node_of = [&](const int64_t value) -> uint32_t {
+            const auto size = index_of.size();
+            auto &index = index_of[value];
+            if (index_of.size() != size) {
+                index = static_cast<int64_t>(values_.size());
+                values_.push_back(value);
+            }
+            return static_cast<uint32_t>(index);
+        };
+
+        for (const auto &value: from_vec) {
+            start_.push_back(node_of(value));
+        }
+
+        // values_ grows while we walk it, until no new value shows up.
+        for (size_t i = 0; i < values_.size(); i++) {
+            const auto value = values_[i];
+            std::array<uint32_t, 2> children{kNoChild, kNoChild};
+            if (value == 0) {
+                children[0] = node_of(1);
+            } else if (const auto digits = digit_count(value); digits % 2 == 0) {
+                const auto half = static_cast<int64_t>(kPow10[digits / 2]);
+                children[0] = node_of(value / half);
+                children[1] = node_of(value % half);
+            } else {
+                children[0] = node_of(value * 2024);
+            }
+            children_.push_back(children);
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return values_.size(); }
+
+    // Number of stones after `blinks` blinks. With `modulus == 0`, counts are exact 128-bit integers and
+    // `overflow` is set once they no longer fit; otherwise every count is reduced modulo `modulus` (< 2^63).
+    count_t count(const uint64_t blinks, const uint64_t modulus = 0, bool *overflow = nullptr) const {
+        bool overflowed = false;
+        count_t total;
+        if (modulus != 0) {
+            total = count_as<uint64_t>(blinks, &overflowed, [modulus](uint64_t &target, const uint64_t value) {
+                target += value;
+                if (target >= modulus) {
+                    target -= modulus;
+                }
+            });
+        } else {
+            total = count_as<count_t>(blinks, &overflowed, [&overflowed](count_t &target, const count_t value) {
+                overflowed |= __builtin_add_overflow(target, value, &target);
+            });
+        }
+
+        if (overflow != nullptr) {
+            *overflow = overflowed;
+        }
+        return total;
     }
 
 private:
-    std::unordered_map<int64_t, int64_t> data_{};
+    template<typename T, typename F>
+    T count_as(const uint64_t blinks, const bool *stop, F &&add_to) const {
+        std::vector<T> counts(values_.size(), 0);
+        std::vector<T> next_counts(values_.size(), 0);
+        for (const auto node: start_) {
+            add_to(counts[node], 1);
+        }
+
+        for (uint64_t blink = 0; blink < blinks && !*stop; blink++) {
+            std::fill(next_counts.begin(), next_counts.end(), 0);
+            for (size_t i = 0; i < counts.size(); i++) {
+                const auto &[first, second] = children_[i];
+                add_to(next_counts[first], counts[i]);
+                if (second != kNoChild) {
+                    add_to(next_counts[second], counts[i]);
+                }
+            }
+            std::swap(counts, next_counts);
+        }
+
+        T total = 0;
+        for (const auto value: counts) {
+            add_to(total, value);
+        }
+        return total;
+    }
+
+    std::vector<int64_t> values_{};
+    std::vector<std::array<uint32_t, 2> > children_{};
+    std::vector<uint32_t> start_{};
 };
 
+std::string to_string(count_t value) {
+    std::string result{};
+    do {
+        result.push_back(static_cast<char>('0' + static_cast<int>(value % 10)));
+        value /= 10;
+    } while (value != 0);
+    std::ranges::reverse(result);
+    return result;
+}
+
 std::vector<std::string> split(const std::string &s, const std::string &delimiter) {
     size_t pos_start = 0;
     size_t pos_end;
@@ -75,8 +393,81 @@ std::vector<std::string> split(const std::string &s, const std::string &delimite
     return res;
 }
 
+template<typename T>
+double time_ms(T &&callback) {
+    const auto start = std::chrono::steady_clock::now();
+    callback();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void run_benchmark(const std::vector<int64_t> &input_data, const size_t max_threads) {
+    constexpr int kBlinks = 75;
+    constexpr int kRounds = 10;
+
+    double string_ms{0}, arithmetic_ms{0};
+    int64_t string_sum{0}, arithmetic_sum{0};
+    for (int round = 0; round < kRounds; round++) {
+        Stones string_stones(input_data);
+        string_ms += time_ms([&] {
+            for (int i = 0; i < kBlinks; i++) {
+                string_stones.blink_string();
+            }
+        });
+        string_sum = string_stones.sum();
+
+        Stones arithmetic_stones(input_data);
+        arithmetic_ms += time_ms([&] {
+            for (int i = 0; i < kBlinks; i++) {
+                arithmetic_stones.blink();
+            }
+        });
+        arithmetic_sum = arithmetic_stones.sum();
+    }
+
+    printf("bench: %d blinks, string=%.3fms, arithmetic=%.3fms, sum %s (%" PRId64 ")\n", kBlinks,
+           string_ms / kRounds, arithmetic_ms / kRounds, string_sum == arithmetic_sum ? "ok" : "MISMATCH",
+           arithmetic_sum);
+
+    for (size_t thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        double sharded_ms{0};
+        int64_t sharded_sum{0};
+        for (int round = 0; round < kRounds; round++) {
+            ShardedStones sharded_stones(input_data, thread_count);
+            sharded_ms += time_ms([&] { sharded_stones.blink(kBlinks); });
+            sharded_sum = sharded_stones.sum();
+        }
+        printf("bench: %d blinks, sharded(%zu)=%.3fms, sum %s\n", kBlinks, thread_count, sharded_ms / kRounds,
+               sharded_sum == arithmetic_sum ? "ok" : "MISMATCH");
+    }
+}
+
 int main(int argc, char **argv) {
-    std::ifstream ifs(argc > 1 ? argv[1] : "sample.txt");
+    bool bench = false;
+    uint64_t blinks = 0;
+    uint64_t modulus = 0;
+    size_t thread_count = std::thread::hardware_concurrency();
+    const char *input_file_path = "sample.txt";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--blinks") == 0 && i + 1 < argc) {
+            blinks = std::stoull(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = std::stoull(argv[++i]);
+        } else if (strcmp(argv[i], "--mod") == 0 && i + 1 < argc) {
+            modulus = std::stoull(argv[++i]);
+            // `StoneGraph::count` adds two reduced counts in 64 bits, which only works below 2^63.
+            if (modulus == 0 || modulus >= uint64_t{1} << 63) {
+                printf("error: --mod must be between 1 and 2^63 - 1\n");
+                return 1;
+            }
+        } else {
+            input_file_path = argv[i];
+        }
+    }
+
+    std::ifstream ifs(input_file_path);
     ifs.seekg(0, std::ios::end);
     std::string input(ifs.tellg(), 0);
     ifs.seekg(0, std::ios::beg);
@@ -86,6 +477,35 @@ int main(int argc, char **argv) {
     for (const auto& v : split(input, " ")) {
         input_data.push_back(stoll(v));
     }
+
+    if (bench) {
+        run_benchmark(input_data, thread_count);
+        return 0;
+    }
+
+    if (blinks != 0) {
+        const StoneGraph graph(input_data);
+        bool overflow = false;
+        const auto total = graph.count(blinks, modulus, &overflow);
+        printf("distinct stones: %zu\n", graph.size());
+        if (overflow) {
+            printf("error: stone count overflows 128 bits before %" PRIu64 " blinks, use --mod\n", blinks);
+            return 1;
+        }
+        printf("stones after %" PRIu64 " blinks%s: %s\n", blinks, modulus != 0 ? " (mod)" : "",
+               to_string(total).c_str());
+        return 0;
+    }
+
+    if (thread_count > 1) {
+        ShardedStones stones(input_data, thread_count);
+        stones.blink(25);
+        std::cout << "p1: " << stones.sum() << std::endl;
+        stones.blink(50);
+        std::cout << "p2: " << stones.sum() << std::endl;
+        return 0;
+    }
+
     Stones stones(input_data);
 
     for (int i = 1; i <= 75; i++) {
@@ -1,65 +1,140 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cinttypes>
 #include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <cstring>
 #include <deque>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
-constexpr uint8_t kEmpty = ' ';
-constexpr uint8_t kWall = '#';
-
 constexpr uint8_t kDirNorth = 0;
 constexpr uint8_t kDirEast = 1;
 constexpr uint8_t kDirSouth = 2;
 constexpr uint8_t kDirWest = 3;
 
-struct position_t {
-    uint8_t x;
-    uint8_t y;
-};
+constexpr uint32_t kStepCost = 1;
+constexpr uint32_t kTurnCost = 1000;
 
-// board size: 141x141, use 256x256 to make addressing faster.
-constexpr size_t kMaxWidth = 256;
-constexpr size_t kMaxHeight = 256;
+// Costs of large mazes (10k x 10k and up) do not fit in 32 bits, a few million turns are enough.
+typedef uint64_t cost_t;
 
-typedef uint8_t board_t[kMaxHeight][kMaxWidth];
+// `--fields` keeps two full cost fields, so it stores them in 32 bits when every best cost fits (see
+// `Board::fits_narrow_costs`), and unreached states as the largest value.
+typedef uint32_t narrow_cost_t;
 
-typedef uint32_t node_t;
-typedef uint64_t node_with_cost_t;
+// Coordinates are stored in 28 bits each, so each side can be up to 2^28 - 1 cells long.
+constexpr uint32_t kMaxSide = 1u << 28;
 
-inline node_t make_node(const uint8_t x, const uint8_t y, const uint8_t direction = 0) {
-    return static_cast<node_t>(direction) << 16 | static_cast<node_t>(x) << 8 | static_cast<node_t>(y);
-}
+struct position_t {
+    uint32_t x;
+    uint32_t y;
+};
 
-inline void parse_node(uint8_t &x, uint8_t &y, uint8_t &direction, const node_t key) {
-    direction = static_cast<uint8_t>(key >> 16);
-    x = static_cast<uint8_t>(key >> 8);
-    y = static_cast<uint8_t>(key);
-}
+// A node is (direction, x, y) packed in 64 bits. Per-state arrays are not indexed by nodes, but by states:
+// (number of open cells before the node's cell) * 4 + direction, see `Board::state_of`.
+typedef uint64_t node_t;
+typedef uint64_t state_t;
 
-inline node_with_cost_t make_node_with_cost(const uint8_t x, const uint8_t y, const uint8_t direction,
-                                            const uint32_t cost) {
-    return static_cast<node_with_cost_t>(cost) << 32 | static_cast<node_with_cost_t>(make_node(x, y, direction));
+inline node_t make_node(const uint32_t x, const uint32_t y, const uint8_t direction = 0) {
+    return static_cast<node_t>(direction) << 56 | static_cast<node_t>(y) << 28 | static_cast<node_t>(x);
 }
 
-inline void parse_node_with_cost(uint8_t &x, uint8_t &y, uint8_t &direction, uint32_t &cost,
-                                 const node_with_cost_t node) {
-    cost = static_cast<uint32_t>(node >> 32);
-    parse_node(x, y, direction, static_cast<node_t>(node));
+inline void parse_node(uint32_t &x, uint32_t &y, uint8_t &direction, const node_t key) {
+    direction = static_cast<uint8_t>(key >> 56);
+    y = static_cast<uint32_t>(key >> 28) & (kMaxSide - 1);
+    x = static_cast<uint32_t>(key) & (kMaxSide - 1);
 }
 
 uint8_t normalize_direction(const uint8_t direction) {
     return direction & 3;
 }
 
+//                           N   E  S   W
+constexpr int8_t kDx[] = {+0, 1, 0, -1};
+constexpr int8_t kDy[] = {-1, 0, 1, +0};
+
+constexpr cost_t kUnreached = UINT64_MAX;
+constexpr node_t kNoParent = UINT64_MAX;
+
+// How a state was reached at its best cost: a bit set per predecessor.
+constexpr uint8_t kParentStep = 1 << 0;     // moved forward from the previous tile
+constexpr uint8_t kParentTurnCw = 1 << 1;   // turned clockwise, from direction - 1
+constexpr uint8_t kParentTurnCcw = 1 << 2;  // turned counterclockwise, from direction + 1
+
+struct search_t {
+    explicit search_t(const size_t state_count) : costs(state_count, kUnreached), parents(state_count, 0) {
+    }
+
+    std::vector<cost_t> costs;
+    std::vector<uint8_t> parents;
+    uint64_t expanded{0};
+};
+
+// With `reverse` (masks from a backwards search), the "parents" are the next states on the way to the end.
+inline std::array<node_t, 3> parent_nodes(const node_t node, const uint8_t parent_mask, const bool reverse = false) {
+    uint32_t x, y;
+    uint8_t d;
+    parse_node(x, y, d, node);
+    const int8_t sign = reverse ? -1 : 1;
+    return {
+        parent_mask & kParentStep ? make_node(x - sign * kDx[d], y - sign * kDy[d], d) : kNoParent,
+        parent_mask & kParentTurnCw ? make_node(x, y, normalize_direction(d + 3)) : kNoParent,
+        parent_mask & kParentTurnCcw ? make_node(x, y, normalize_direction(d + 1)) : kNoParent,
+    };
+}
+
+// Walls are bit-packed (one bit per cell, set when open), and every 64-cell word keeps the number of open
+// cells before it. That gives each open cell a dense rank, so per-state arrays only cover open cells.
 class Board {
 public:
     explicit Board(const std::string &input) {
-        memset(board_, kWall, sizeof(board_));
+        size_t x = 0;
+        size_t width = 0, height = 0;
+        for (const char c: input) {
+            if (c == '\n') {
+                width = std::max(width, x);
+                height++;
+                x = 0;
+            } else if (c != '\r' && c != 0) {
+                x++;
+            }
+        }
+        if (x > 0) {
+            width = std::max(width, x);
+            height++;
+        }
 
-        size_t x = 0, y = 0;
-        size_t width = 0;
+        if (width >= kMaxSide || height >= kMaxSide) {
+            printf("board too large: %zux%zu\n", width, height);
+            return;
+        }
+        width_ = static_cast<uint32_t>(width);
+        height_ = static_cast<uint32_t>(height);
+        open_.assign((static_cast<size_t>(width_) * height_ + 63) / 64, 0);
+
+        x = 0;
+        size_t y = 0;
+        auto set_open = [&] {
+            const auto cell = y * width_ + x;
+            open_[cell / 64] |= uint64_t{1} << (cell % 64);
+        };
         for (const char c: input) {
             switch (c) {
                 case 0:
@@ -67,46 +142,131 @@ public:
 
                 case '\n':
                     ++y;
-                    width = x;
                     x = 0;
                     break;
                 case '.':
-                    board_[y][x++] = kEmpty;
+                    set_open();
+                    x++;
                     break;
                 case '#':
-                    board_[y][x++] = kWall;
+                    x++;
                     break;
                 case 'S':
-                    start_ = {static_cast<uint8_t>(x), static_cast<uint8_t>(y)};
-                    board_[y][x++] = kEmpty;
+                    start_ = {static_cast<uint32_t>(x), static_cast<uint32_t>(y)};
+                    set_open();
+                    x++;
                     break;
                 case 'E':
-                    end_ = {static_cast<uint8_t>(x), static_cast<uint8_t>(y)};
-                    board_[y][x++] = kEmpty;
+                    end_ = {static_cast<uint32_t>(x), static_cast<uint32_t>(y)};
+                    set_open();
+                    x++;
                     break;
                 default:
                     printf("invalid character: %c (0x%02x)\n", isprint(c) ? c : '.', static_cast<int>(c));
             }
         }
 
-        size_ = {static_cast<uint8_t>(width), static_cast<uint8_t>(y)};
+        rank_.resize(open_.size());
+        for (size_t i = 0; i < open_.size(); i++) {
+            rank_[i] = open_cells_;
+            open_cells_ += std::popcount(open_[i]);
+        }
+    }
+
+    // Out of range coordinates (including the ones that wrapped below 0) are walls.
+    [[nodiscard]] bool is_wall(const uint32_t x, const uint32_t y) const {
+        if (x >= width_ || y >= height_) {
+            return true;
+        }
+        const auto cell = static_cast<size_t>(y) * width_ + x;
+        return (open_[cell / 64] >> (cell % 64) & 1) == 0;
+    }
+
+    [[nodiscard]] size_t state_count() const { return open_cells_ * 4; }
+    [[nodiscard]] uint64_t open_cells() const { return open_cells_; }
+    [[nodiscard]] uint32_t width() const { return width_; }
+    [[nodiscard]] uint32_t height() const { return height_; }
+    [[nodiscard]] position_t start() const { return start_; }
+    [[nodiscard]] position_t end() const { return end_; }
+
+    [[nodiscard]] uint8_t open_neighbours(const uint32_t x, const uint32_t y) const {
+        uint8_t count = 0;
+        for (uint8_t d = 0; d < 4; d++) {
+            count += !is_wall(x + kDx[d], y + kDy[d]);
+        }
+        return count;
+    }
+
+    [[nodiscard]] state_t state_of(const node_t node) const {
+        uint32_t x, y;
+        uint8_t d;
+        parse_node(x, y, d, node);
+        const auto cell = static_cast<size_t>(y) * width_ + x;
+        const auto below = open_[cell / 64] & ((uint64_t{1} << (cell % 64)) - 1);
+        return (rank_[cell / 64] + std::popcount(below)) * 4 + d;
+    }
+
+    // Dijkstra with a bucket queue (Dial's algorithm) from the start, facing east.
+    [[nodiscard]] search_t build_dijkstra() const {
+        search_t search(state_count());
+        auto &parents = search.parents;
+        search.expanded = run_dijkstra(search.costs, {make_node(start_.x, start_.y, kDirEast)}, false,
+                                       [&](const state_t state, const uint8_t parent_bit, const bool improved) {
+                                           parents[state] = improved ? parent_bit : parents[state] | parent_bit;
+                                       });
+        return search;
     }
 
-    [[nodiscard]] std::pair<std::unordered_map<node_t, uint32_t>, std::unordered_map<node_t, std::vector<node_t> > >
-    build_dijkstra() const {
-        std::unordered_map<node_t, uint32_t> costs{};
+    // A* towards the end, ordered by cost + `turn_aware_distance`. The bound never drops by more than a move costs
+    // (a step cannot remove a needed turn, a turn removes at most one), so states are still settled once, at their
+    // best cost. It keeps going until every state with cost + bound <= best is settled: those are the only ones
+    // that can be on a best path, and their parent masks are then complete.
+    [[nodiscard]] search_t build_astar() const {
+        search_t search(state_count());
+        auto &[costs, parents, expanded] = search;
+        expanded = run_search<kAstarBuckets>(
+            costs, {make_node(start_.x, start_.y, kDirEast)}, false,
+            [&](const state_t state, const uint8_t parent_bit, const bool improved) {
+                parents[state] = improved ? parent_bit : parents[state] | parent_bit;
+            },
+            [&](const node_t node) { return turn_aware_distance(node, end_); },
+            [&](const cost_t key) {
+                cost_t best = kUnreached;
+                for (uint8_t i = 0; i < 4; i++) {
+                    best = std::min(best, costs[state_of(make_node(end_.x, end_.y, i))]);
+                }
+                return key > best;
+            });
+        return search;
+    }
+
+    // Cost field without parents. With `reverse`, costs[node] is the cheapest cost from `node` to any source.
+    template<typename C = cost_t>
+    [[nodiscard]] std::vector<C> build_distances(const std::vector<node_t> &sources, const bool reverse) const {
+        std::vector costs(state_count(), std::numeric_limits<C>::max());
+        run_dijkstra(costs, sources, reverse, [](state_t, uint8_t, bool) {
+        });
+        return costs;
+    }
+
+    // Previous search: a FIFO queue that re-queues a node every time its cost improves (SPFA / Bellman-Ford),
+    // so nodes can be expanded many times. Kept as a reference for `--bench`.
+    [[nodiscard]] std::pair<std::unordered_map<node_t, cost_t>, std::unordered_map<node_t, std::vector<node_t> > >
+    build_spfa() const {
+        std::unordered_map<node_t, cost_t> costs{};
         std::unordered_map<node_t, std::vector<node_t> > parents{};
 
-        std::deque work{make_node_with_cost(start_.x, start_.y, kDirEast, 0)};
+        std::deque<std::pair<node_t, cost_t> > work{{make_node(start_.x, start_.y, kDirEast), 0}};
+        costs[make_node(start_.x, start_.y, kDirEast)] = 0;
 
 
         //                            N   E  S   W
         constexpr int8_t dx_list[] = {+0, 1, 0, -1};
         constexpr int8_t dy_list[] = {-1, 0, 1, +0};
 
-        auto explore_node = [&](const node_t current_node, const uint8_t x, const uint8_t y, const uint8_t new_dir,
-                                const uint32_t new_cost) {
-            if (board_[y][x] == kWall) {
+        auto explore_node = [&](const node_t current_node, const uint32_t x, const uint32_t y, const uint8_t new_dir,
+                                const cost_t new_cost) {
+            if (is_wall(x, y)) {
                 return;
             }
 
@@ -116,70 +276,968 @@ public:
             if (!costs.contains(next_node) || new_cost < costs[next_node]) {
                 costs[next_node] = new_cost;
                 parents[next_node] = {current_node};
-                work.push_back(make_node_with_cost(x, y, new_dir, new_cost));
+                work.emplace_back(next_node, new_cost);
             } else if (new_cost == costs[next_node]) {
                 parents[next_node].push_back(current_node);
             }
         };
 
 
-        uint8_t cx, cy, cd;
-        uint32_t cost;
+        uint32_t cx, cy;
+        uint8_t cd;
         for (; !work.empty(); work.pop_front()) {
-            const auto current_node = static_cast<node_t>(work.front());
-            parse_node_with_cost(cx, cy, cd, cost, work.front());
+            const auto [current_node, cost] = work.front();
+            parse_node(cx, cy, cd, current_node);
 
-            explore_node(current_node, cx + dx_list[cd], cy + dy_list[cd], cd, cost + 1);
-            explore_node(current_node, cx, cy, normalize_direction(cd + 1), cost + 1000);
-            explore_node(current_node, cx, cy, normalize_direction(cd + 3), cost + 1000);
+            explore_node(current_node, cx + dx_list[cd], cy + dy_list[cd], cd, cost + kStepCost);
+            explore_node(current_node, cx, cy, normalize_direction(cd + 1), cost + kTurnCost);
+            explore_node(current_node, cx, cy, normalize_direction(cd + 3), cost + kTurnCost);
         }
 
         return {costs, parents};
     }
 
-    [[nodiscard]] std::pair<uint32_t, uint32_t> solve() const {
-        auto [costs, parents] = build_dijkstra();
+    [[nodiscard]] std::pair<cost_t, uint64_t> solve(uint64_t *expanded = nullptr) const {
+        const auto search = build_dijkstra();
+        if (expanded) {
+            *expanded = search.expanded;
+        }
+        return backtrack_tiles(search);
+    }
+
+    [[nodiscard]] std::pair<cost_t, uint64_t> solve_astar(uint64_t *expanded = nullptr) const {
+        const auto search = build_astar();
+        if (expanded) {
+            *expanded = search.expanded;
+        }
+        return backtrack_tiles(search);
+    }
 
-        uint32_t min_cost = UINT32_MAX;
-        std::unordered_map<uint32_t, std::deque<node_t> > cache{};
+    // Bidirectional Dijkstra: one bucket queue forward from the start, one backwards from the end states, always
+    // advancing the side with the lower cost. `best` is the cheapest path through a state reached from both sides,
+    // and the search stops once the two frontier costs add up to more than it. Costs only grow along a path from
+    // the start, so every best path is then a prefix settled forward followed by a suffix settled backwards; tiles
+    // are collected by walking both parent masks out from the moves where the settled parts meet.
+    [[nodiscard]] std::pair<cost_t, uint64_t> solve_bidirectional(uint64_t *expanded = nullptr) const {
+        side_t forward(state_count());
+        side_t backward(state_count());
+        enqueue_source(forward, make_node(start_.x, start_.y, kDirEast));
         for (uint8_t i = 0; i < 4; i++) {
-            auto const node = make_node(end_.x, end_.y, i);
-            if (auto it = costs.find(node); it != costs.end()) {
-                min_cost = std::min(min_cost, it->second);
-                cache[it->second].push_back(node);
+            enqueue_source(backward, make_node(end_.x, end_.y, i));
+        }
+
+        cost_t best = kUnreached;
+        expand_bucket(forward, backward, false, best);
+        expand_bucket(backward, forward, true, best);
+        while (forward.queued > 0 && backward.queued > 0 && forward.cost + backward.cost <= best) {
+            if (forward.cost <= backward.cost) {
+                expand_bucket(forward, backward, false, best);
+            } else {
+                expand_bucket(backward, forward, true, best);
             }
         }
+        if (expanded) {
+            *expanded = forward.settled.size() + backward.settled.size();
+        }
 
         // Did not find a path.
-        if (min_cost == UINT32_MAX) {
+        if (best == kUnreached) {
             return {0, {}};
         }
 
-        std::unordered_set visited{make_node(start_.x, start_.y), make_node(end_.x, end_.y)};
-        uint8_t x, y, d;
-        for (auto work = std::move(cache[min_cost]); !work.empty(); work.pop_front()) {
-            const auto node = work.front();
-            parse_node(x, y, d, node);
+        // Meeting points: a forward settled state and its backward settled successor (or itself) on a best path.
+        std::vector<bool> forward_marked(state_count(), false), backward_marked(state_count(), false);
+        std::vector<node_t> forward_work{}, backward_work{};
+        auto mark = [](std::vector<bool> &marked, std::vector<node_t> &work, const node_t node, const state_t state) {
+            if (!marked[state]) {
+                marked[state] = true;
+                work.push_back(node);
+            }
+        };
+        auto meets = [&](const node_t node, const state_t state, const uint32_t x, const uint32_t y, const uint8_t d,
+                         const cost_t move_cost) {
+            if (is_wall(x, y)) {
+                return;
+            }
+            const auto next_node = make_node(x, y, d);
+            const auto next_state = state_of(next_node);
+            if (backward.costs[next_state] < backward.cost &&
+                forward.costs[state] + move_cost + backward.costs[next_state] == best) {
+                mark(forward_marked, forward_work, node, state);
+                mark(backward_marked, backward_work, next_node, next_state);
+            }
+        };
+        uint32_t cx, cy;
+        uint8_t cd;
+        for (const auto node: forward.settled) {
+            const auto state = state_of(node);
+            parse_node(cx, cy, cd, node);
+            meets(node, state, cx, cy, cd, 0);
+            meets(node, state, cx + kDx[cd], cy + kDy[cd], cd, kStepCost);
+            meets(node, state, cx, cy, normalize_direction(cd + 1), kTurnCost);
+            meets(node, state, cx, cy, normalize_direction(cd + 3), kTurnCost);
+        }
 
-            for (const auto &parent_node: parents[node]) {
-                visited.insert(make_node(x, y));
-                work.push_back(parent_node);
+        std::vector<bool> tiles(open_cells_, false);
+        uint64_t tile_count = 0;
+        auto walk = [&](const side_t &side, std::vector<bool> &marked, std::vector<node_t> &work, const bool reverse) {
+            while (!work.empty()) {
+                const auto node = work.back();
+                work.pop_back();
+                const auto state = state_of(node);
+                if (!tiles[state / 4]) {
+                    tiles[state / 4] = true;
+                    tile_count++;
+                }
+                for (const auto parent_node: parent_nodes(node, side.parents[state], reverse)) {
+                    if (parent_node != kNoParent) {
+                        mark(marked, work, parent_node, state_of(parent_node));
+                    }
+                }
             }
-            parents[node].clear();
+        };
+        walk(forward, forward_marked, forward_work, false);
+        walk(backward, backward_marked, backward_work, true);
+
+        return {best, tile_count};
+    }
+
+    // Part 2 without parents: a forward field from the start and a reverse field from all four end states, built
+    // on two threads. A state is on a best path exactly when forward + reverse == best.
+    [[nodiscard]] std::pair<cost_t, uint64_t> solve_fields() const {
+        return fits_narrow_costs() ? solve_fields<narrow_cost_t>() : solve_fields<cost_t>();
+    }
+
+    // A best path never enters a cell twice: coming back needs at least two steps and a U-turn (two turns), while
+    // turning on the spot the first time costs at most two turns. So it takes at most one step and two turns per
+    // open cell, and no cost in a field is larger than that.
+    [[nodiscard]] bool fits_narrow_costs() const {
+        return open_cells_ * (kStepCost + 2 * kTurnCost) < std::numeric_limits<narrow_cost_t>::max();
+    }
+
+    // costs[state] is the cheapest cost from `state` to `end`, arriving from any direction.
+    template<typename C = cost_t>
+    [[nodiscard]] std::vector<C> build_reverse_field(const position_t end) const {
+        std::vector<node_t> end_nodes{};
+        for (uint8_t i = 0; i < 4; i++) {
+            end_nodes.push_back(make_node(end.x, end.y, i));
+        }
+        return build_distances<C>(end_nodes, true);
+    }
+
+    // Best path between any open cell (starting east) and the end of a reverse field, without searching again: the
+    // best cost is backward[start], and a move lies on a best path when its cost plus backward[next] equals
+    // backward[current]. Only the states on best paths are visited, so a query costs as much as its paths are long.
+    [[nodiscard]] std::pair<cost_t, uint64_t> solve_query(const position_t start,
+                                                          const std::vector<cost_t> &backward) const {
+        const auto start_node = make_node(start.x, start.y, kDirEast);
+        const auto best = backward[state_of(start_node)];
+
+        // Did not find a path.
+        if (best == kUnreached) {
+            return {0, {}};
         }
 
-        return {min_cost, static_cast<uint32_t>(visited.size())};
+        std::unordered_set<state_t> visited{state_of(start_node)};
+        std::unordered_set<state_t> tiles{};
+        std::vector<node_t> work{start_node};
+        auto explore_node = [&](const cost_t remaining, const uint32_t x, const uint32_t y, const uint8_t d,
+                                const cost_t move_cost) {
+            if (is_wall(x, y)) {
+                return;
+            }
+            const auto next_node = make_node(x, y, d);
+            if (const auto next_state = state_of(next_node);
+                backward[next_state] != kUnreached && move_cost + backward[next_state] == remaining &&
+                visited.insert(next_state).second) {
+                work.push_back(next_node);
+            }
+        };
+
+        uint32_t cx, cy;
+        uint8_t cd;
+        while (!work.empty()) {
+            const auto node = work.back();
+            work.pop_back();
+            const auto state = state_of(node);
+            tiles.insert(state / 4);
+
+            const auto remaining = backward[state];
+            parse_node(cx, cy, cd, node);
+            explore_node(remaining, cx + kDx[cd], cy + kDy[cd], cd, kStepCost);
+            explore_node(remaining, cx, cy, normalize_direction(cd + 1), kTurnCost);
+            explore_node(remaining, cx, cy, normalize_direction(cd + 3), kTurnCost);
+        }
+
+        return {best, tiles.size()};
     }
 
 private:
-    position_t size_{};
+    // A* costs can jump by a turn plus the turn it adds to the bound: keys stay within [key, key + 2000].
+    static constexpr uint32_t kAstarBuckets = 2 * kTurnCost + 1;
+
+    // One direction of `solve_bidirectional`: a bucket queue that is expanded one cost at a time. States with a cost
+    // below `cost` are settled.
+    struct side_t {
+        explicit side_t(const size_t state_count) : costs(state_count, kUnreached), parents(state_count, 0) {
+        }
+
+        std::vector<cost_t> costs;
+        std::vector<uint8_t> parents;
+        std::array<std::vector<node_t>, kTurnCost + 1> buckets{};
+        std::vector<node_t> settled{};
+        cost_t cost{0};
+        size_t queued{0};
+    };
+
+    void enqueue_source(side_t &side, const node_t node) const {
+        side.costs[state_of(node)] = 0;
+        side.buckets[0].push_back(node);
+        side.queued++;
+    }
+
+    // Settles the states of `side` at `side.cost`, and lowers `best` for every move that reaches a state the other
+    // side already has a cost for.
+    void expand_bucket(side_t &side, const side_t &other, const bool reverse, cost_t &best) const {
+        constexpr uint32_t kBuckets = kTurnCost + 1;
+        auto explore_node = [&](const uint32_t x, const uint32_t y, const uint8_t new_dir, const cost_t new_cost,
+                                const uint8_t parent_bit) {
+            if (is_wall(x, y)) {
+                return;
+            }
+
+            const auto next_node = make_node(x, y, new_dir);
+            const auto next_state = state_of(next_node);
+            if (new_cost < side.costs[next_state]) {
+                side.costs[next_state] = new_cost;
+                side.parents[next_state] = parent_bit;
+                side.buckets[new_cost % kBuckets].push_back(next_node);
+                side.queued++;
+            } else if (new_cost == side.costs[next_state]) {
+                side.parents[next_state] |= parent_bit;
+            }
+            if (other.costs[next_state] != kUnreached) {
+                best = std::min(best, new_cost + other.costs[next_state]);
+            }
+        };
+
+        const int8_t sign = reverse ? -1 : 1;
+        uint32_t cx, cy;
+        uint8_t cd;
+        auto &bucket = side.buckets[side.cost % kBuckets];
+        for (const auto current_node: bucket) {
+            side.queued--;
+            const auto current_state = state_of(current_node);
+            if (side.costs[current_state] != side.cost) {
+                continue;
+            }
+
+            side.settled.push_back(current_node);
+            if (other.costs[current_state] != kUnreached) {
+                best = std::min(best, side.cost + other.costs[current_state]);
+            }
+            parse_node(cx, cy, cd, current_node);
+            explore_node(cx + sign * kDx[cd], cy + sign * kDy[cd], cd, side.cost + kStepCost, kParentStep);
+            explore_node(cx, cy, normalize_direction(cd + 1), side.cost + kTurnCost, kParentTurnCw);
+            explore_node(cx, cy, normalize_direction(cd + 3), side.cost + kTurnCost, kParentTurnCcw);
+        }
+        bucket.clear();
+        side.cost++;
+    }
+
+    // Lower bound of the cost from `node` to `end`: every remaining step, plus a turn per direction change still
+    // needed. Facing along one needed axis leaves one turn if the end is off both axes, facing away leaves two.
+    [[nodiscard]] static cost_t turn_aware_distance(const node_t node, const position_t end) {
+        uint32_t x, y;
+        uint8_t d;
+        parse_node(x, y, d, node);
+        const auto dx = static_cast<int64_t>(end.x) - x;
+        const auto dy = static_cast<int64_t>(end.y) - y;
+        const uint8_t dir_x = dx > 0 ? kDirEast : kDirWest;
+        const uint8_t dir_y = dy > 0 ? kDirSouth : kDirNorth;
+
+        uint32_t turns = 0;
+        if (dx != 0 && dy != 0) {
+            turns = d == dir_x || d == dir_y ? 1 : 2;
+        } else if (dx != 0 || dy != 0) {
+            const auto needed = dx != 0 ? dir_x : dir_y;
+            turns = d == needed ? 0 : d == normalize_direction(needed + 2) ? 2 : 1;
+        }
+        return static_cast<cost_t>(std::abs(dx) + std::abs(dy)) * kStepCost + turns * kTurnCost;
+    }
+
+    // Walks the parent masks back from the end states that have the best cost, marking every tile on the way.
+    [[nodiscard]] std::pair<cost_t, uint64_t> backtrack_tiles(const search_t &search) const {
+        const auto &costs = search.costs;
+        const auto &parents = search.parents;
+
+        cost_t min_cost = kUnreached;
+        for (uint8_t i = 0; i < 4; i++) {
+            min_cost = std::min(min_cost, costs[state_of(make_node(end_.x, end_.y, i))]);
+        }
+
+        // Did not find a path.
+        if (min_cost == kUnreached) {
+            return {0, {}};
+        }
+
+        // Tiles are indexed by open cell rank, i.e. state / 4.
+        std::vector<bool> tiles(open_cells_, false);
+        std::vector<bool> visited(state_count(), false);
+        std::vector<node_t> work{};
+        for (uint8_t i = 0; i < 4; i++) {
+            const auto node = make_node(end_.x, end_.y, i);
+            if (const auto state = state_of(node); costs[state] == min_cost) {
+                visited[state] = true;
+                work.push_back(node);
+            }
+        }
+
+        uint64_t tile_count = 0;
+        while (!work.empty()) {
+            const auto node = work.back();
+            work.pop_back();
+            const auto state = state_of(node);
+            if (!tiles[state / 4]) {
+                tiles[state / 4] = true;
+                tile_count++;
+            }
+
+            for (const auto parent_node: parent_nodes(node, parents[state])) {
+                if (parent_node == kNoParent) {
+                    continue;
+                }
+                if (const auto parent_state = state_of(parent_node); !visited[parent_state]) {
+                    visited[parent_state] = true;
+                    work.push_back(parent_node);
+                }
+            }
+        }
+
+        return {min_cost, tile_count};
+    }
+
+    template<typename C>
+    [[nodiscard]] std::pair<cost_t, uint64_t> solve_fields() const {
+        std::vector<C> forward{};
+        std::thread forward_thread([&] {
+            forward = build_distances<C>({make_node(start_.x, start_.y, kDirEast)}, false);
+        });
+        const auto backward = build_reverse_field<C>(end_);
+        forward_thread.join();
+        return count_best_tiles(forward, backward, end_);
+    }
+
+    template<typename C>
+    [[nodiscard]] std::pair<cost_t, uint64_t> count_best_tiles(const std::vector<C> &forward,
+                                                               const std::vector<C> &backward,
+                                                               const position_t end) const {
+        constexpr auto unreached = std::numeric_limits<C>::max();
+        cost_t min_cost = kUnreached;
+        for (uint8_t i = 0; i < 4; i++) {
+            if (const auto cost = forward[state_of(make_node(end.x, end.y, i))]; cost != unreached) {
+                min_cost = std::min<cost_t>(min_cost, cost);
+            }
+        }
+
+        // Did not find a path.
+        if (min_cost == kUnreached) {
+            return {0, {}};
+        }
+
+        // A tile counts once, even if several of its 4 states (state / 4 == tile) are on a best path.
+        uint64_t tile_count = 0;
+        for (state_t tile = 0; tile < open_cells_; tile++) {
+            for (state_t state = tile * 4; state < tile * 4 + 4; state++) {
+                if (forward[state] != unreached && backward[state] != unreached &&
+                    cost_t{forward[state]} + backward[state] == min_cost) {
+                    tile_count++;
+                    break;
+                }
+            }
+        }
+
+        return {min_cost, tile_count};
+    }
+
+    // Dial's algorithm: edges cost either 1 or 1000, so every queued cost is within [cost, cost + 1000] of the one
+    // being expanded, and `cost % kBuckets` picks a distinct bucket for each. Every (x, y, dir) state is settled
+    // (expanded) exactly once. With `reverse`, moves are walked backwards. `on_parent(node, parent_bit, improved)`
+    // is called whenever a predecessor reaches `node` at its best known cost (`improved` if that cost just dropped).
+    template<typename C, typename F>
+    uint64_t run_dijkstra(std::vector<C> &costs, const std::vector<node_t> &sources, const bool reverse,
+                          F &&on_parent) const {
+        return run_search<kTurnCost + 1>(costs, sources, reverse, on_parent, [](node_t) { return cost_t{0}; },
+                                         [](cost_t) { return false; });
+    }
+
+    // `run_dijkstra` with buckets ordered by cost + heuristic(node) (A*), stopping before the first key that
+    // `done(key)` rejects. Keys of queued nodes must stay within `kBuckets - 1` of the one being expanded.
+    // Returns the number of states expanded.
+    template<uint32_t kBuckets, typename C, typename F, typename H, typename D>
+    uint64_t run_search(std::vector<C> &costs, const std::vector<node_t> &sources, const bool reverse,
+                        F &&on_parent, H &&heuristic, D &&done) const {
+        std::array<std::vector<node_t>, kBuckets> buckets{};
+        size_t queued = 0;
+
+        auto explore_node = [&](const uint32_t x, const uint32_t y, const uint8_t new_dir, const cost_t new_cost,
+                                const uint8_t parent_bit) {
+            if (is_wall(x, y)) {
+                return;
+            }
+
+            // ReSharper disable once CppTooWideScopeInitStatement
+            const auto next_node = make_node(x, y, new_dir);
+            const auto next_state = state_of(next_node);
+
+            if (new_cost < costs[next_state]) {
+                costs[next_state] = static_cast<C>(new_cost);
+                on_parent(next_state, parent_bit, true);
+                buckets[(new_cost + heuristic(next_node)) % kBuckets].push_back(next_node);
+                queued++;
+            } else if (new_cost == costs[next_state]) {
+                on_parent(next_state, parent_bit, false);
+            }
+        };
+
+        cost_t first_key = kUnreached;
+        for (const auto source: sources) {
+            costs[state_of(source)] = 0;
+            first_key = std::min(first_key, heuristic(source));
+            buckets[heuristic(source) % kBuckets].push_back(source);
+            queued++;
+        }
+
+        const int8_t sign = reverse ? -1 : 1;
+        uint32_t cx, cy;
+        uint8_t cd;
+        uint64_t expanded = 0;
+        for (cost_t key = first_key; queued > 0 && !done(key); key++) {
+            auto &bucket = buckets[key % kBuckets];
+            // Expanding a node queues keys >= `key`. Equal ones (A* moves that keep the bound tight) are appended to
+            // this bucket and expanded in the same pass, hence the index loop.
+            for (size_t i = 0; i < bucket.size(); i++) {
+                const auto current_node = bucket[i];
+                const cost_t cost = costs[state_of(current_node)];
+                queued--;
+                // Skip stale entries, the node was queued again with a lower cost.
+                if (cost + heuristic(current_node) != key) {
+                    continue;
+                }
+
+                expanded++;
+                parse_node(cx, cy, cd, current_node);
+                explore_node(cx + sign * kDx[cd], cy + sign * kDy[cd], cd, cost + kStepCost, kParentStep);
+                explore_node(cx, cy, normalize_direction(cd + 1), cost + kTurnCost, kParentTurnCw);
+                explore_node(cx, cy, normalize_direction(cd + 3), cost + kTurnCost, kParentTurnCcw);
+            }
+            bucket.clear();
+        }
+        return expanded;
+    }
+
+    uint32_t width_{0};
+    uint32_t height_{0};
     position_t start_{};
     position_t end_{};
-    board_t board_{};
+    std::vector<uint64_t> open_{};
+    std::vector<uint64_t> rank_{};
+    uint64_t open_cells_{0};
 };
 
-int main(const int argc, char **argv) {
-    const char *input_file_path = argc > 1 ? argv[1] : "sample.txt";
+// The maze with its corridors contracted. Nodes are junctions: open cells without exactly two open neighbours (so
+// dead ends too), plus the start and the end. Each corridor becomes one edge, from a junction leaving in some
+// direction to the junction (and direction) it arrives at, carrying the step and turn cost of the whole corridor
+// and the number of tiles inside it. States are junction * 4 + direction; a state has at most one corridor edge
+// out (in its direction) and one in (from the cell behind it), plus the two turns.
+class JunctionGraph {
+public:
+    explicit JunctionGraph(const Board &board) {
+        std::vector junction_of(board.open_cells(), kNoJunction);
+        auto rank_of = [&](const uint32_t x, const uint32_t y) { return board.state_of(make_node(x, y)) / 4; };
+
+        const auto start = board.start();
+        const auto end = board.end();
+        for (uint32_t y = 0; y < board.height(); y++) {
+            for (uint32_t x = 0; x < board.width(); x++) {
+                if (board.is_wall(x, y)) {
+                    continue;
+                }
+                const bool is_start = x == start.x && y == start.y;
+                const bool is_end = x == end.x && y == end.y;
+                if (is_start || is_end || board.open_neighbours(x, y) != 2) {
+                    junction_of[rank_of(x, y)] = static_cast<uint32_t>(junctions_.size());
+                    junctions_.push_back({x, y});
+                }
+            }
+        }
+
+        forward_.assign(state_count(), {kNoJunction, 0, 0});
+        backward_.assign(state_count(), {kNoJunction, 0, 0});
+        for (uint32_t junction = 0; junction < junctions_.size(); junction++) {
+            for (uint8_t d = 0; d < 4; d++) {
+                auto [x, y] = junctions_[junction];
+                if (board.is_wall(x + kDx[d], y + kDy[d])) {
+                    continue;
+                }
+
+                // Walk the corridor until the next junction.
+                uint8_t dir = d;
+                cost_t cost = 0;
+                uint64_t tiles = 0;
+                x += kDx[dir];
+                y += kDy[dir];
+                cost += kStepCost;
+                uint32_t next_junction;
+                while ((next_junction = junction_of[rank_of(x, y)]) == kNoJunction) {
+                    const auto back = normalize_direction(dir + 2);
+                    uint8_t next_dir = 0;
+                    while (next_dir == back || board.is_wall(x + kDx[next_dir], y + kDy[next_dir])) {
+                        next_dir++;
+                    }
+                    if (next_dir != dir) {
+                        cost += kTurnCost;
+                    }
+                    dir = next_dir;
+                    x += kDx[dir];
+                    y += kDy[dir];
+                    cost += kStepCost;
+                    tiles++;
+                }
+
+                // Both ends of a corridor walk it, the second one reuses the id from the first.
+                const auto from_state = junction * 4 + d;
+                const auto to_state = next_junction * 4 + dir;
+                const auto reverse_state = next_junction * 4 + normalize_direction(dir + 2);
+                auto corridor = static_cast<uint32_t>(corridor_tiles_.size());
+                if (forward_[reverse_state].to != kNoJunction) {
+                    corridor = forward_[reverse_state].corridor;
+                } else {
+                    corridor_tiles_.push_back(tiles);
+                }
+                forward_[from_state] = {to_state, cost, corridor};
+                max_edge_cost_ = std::max(max_edge_cost_, cost);
+                backward_[to_state] = {from_state, cost, corridor};
+            }
+        }
+
+        start_state_ = junction_of[rank_of(start.x, start.y)] * 4 + kDirEast;
+        end_junction_ = junction_of[rank_of(end.x, end.y)];
+    }
+
+    [[nodiscard]] size_t state_count() const { return junctions_.size() * 4; }
+
+    // Same as `Board::solve_fields`, on the junction graph: a junction is on a best path when one of its states is,
+    // and a corridor when one of its edges is. Its inner tiles are then counted once.
+    [[nodiscard]] std::pair<cost_t, uint64_t> solve() const {
+        const auto forward = build_distances({start_state_}, false);
+        std::vector<uint32_t> end_states{};
+        for (uint8_t i = 0; i < 4; i++) {
+            end_states.push_back(end_junction_ * 4 + i);
+        }
+        const auto backward = build_distances(end_states, true);
+
+        cost_t min_cost = kUnreached;
+        for (const auto state: end_states) {
+            min_cost = std::min(min_cost, forward[state]);
+        }
+
+        // Did not find a path.
+        if (min_cost == kUnreached) {
+            return {0, {}};
+        }
+
+        auto on_best_path = [&](const uint32_t from, const cost_t cost, const uint32_t to) {
+            return forward[from] != kUnreached && backward[to] != kUnreached &&
+                   forward[from] + cost + backward[to] == min_cost;
+        };
+
+        uint64_t tile_count = 0;
+        std::vector<bool> corridor_used(corridor_tiles_.size(), false);
+        for (uint32_t junction = 0; junction < junctions_.size(); junction++) {
+            bool junction_used = false;
+            for (uint32_t state = junction * 4; state < junction * 4 + 4; state++) {
+                junction_used |= on_best_path(state, 0, state);
+                if (const auto &[to, cost, corridor] = forward_[state];
+                    to != kNoJunction && !corridor_used[corridor] && on_best_path(state, cost, to)) {
+                    corridor_used[corridor] = true;
+                    tile_count += corridor_tiles_[corridor];
+                }
+            }
+            tile_count += junction_used;
+        }
+
+        return {min_cost, tile_count};
+    }
+
+private:
+    static constexpr uint32_t kNoJunction = UINT32_MAX;
+
+    struct corridor_edge_t {
+        uint32_t to;
+        cost_t cost;
+        uint32_t corridor;
+    };
+
+    // The same bucket queue as `Board::run_dijkstra`, with one bucket per cost up to the longest edge.
+    [[nodiscard]] std::vector<cost_t> build_distances(const std::vector<uint32_t> &sources, const bool reverse) const {
+        const auto bucket_count = std::max<cost_t>(max_edge_cost_, kTurnCost) + 1;
+
+        std::vector costs(state_count(), kUnreached);
+        std::vector<std::vector<uint32_t> > buckets(bucket_count);
+        size_t queued = 0;
+        auto explore_state = [&](const uint32_t state, const cost_t cost) {
+            if (cost < costs[state]) {
+                costs[state] = cost;
+                buckets[cost % bucket_count].push_back(state);
+                queued++;
+            }
+        };
+
+        for (const auto source: sources) {
+            explore_state(source, 0);
+        }
+
+        const auto &edges = reverse ? backward_ : forward_;
+        for (cost_t cost = 0; queued > 0; cost++) {
+            auto &bucket = buckets[cost % bucket_count];
+            // Edges cost at least one step, expanding never queues into this bucket.
+            for (const auto state: bucket) {
+                queued--;
+                if (costs[state] != cost) {
+                    continue;
+                }
+
+                const auto junction = state / 4;
+                const auto dir = static_cast<uint8_t>(state % 4);
+                if (const auto &[to, edge_cost, corridor] = edges[state]; to != kNoJunction) {
+                    explore_state(to, cost + edge_cost);
+                }
+                explore_state(junction * 4 + normalize_direction(dir + 1), cost + kTurnCost);
+                explore_state(junction * 4 + normalize_direction(dir + 3), cost + kTurnCost);
+            }
+            bucket.clear();
+        }
+        return costs;
+    }
+
+    std::vector<position_t> junctions_{};
+    std::vector<corridor_edge_t> forward_{};
+    std::vector<corridor_edge_t> backward_{};
+    std::vector<uint64_t> corridor_tiles_{};
+    uint32_t start_state_{0};
+    uint32_t end_junction_{0};
+    cost_t max_edge_cost_{0};
+};
+
+// Answers (start, end) queries against one resident board. The reverse field towards an end is shared by every
+// query to that end, so the last `capacity` of them are kept in an LRU cache. A miss publishes a future before
+// building the field, so concurrent queries to the same end wait for it instead of building it again.
+class RouteService {
+public:
+    RouteService(const Board &board, const size_t capacity) : board_(board), capacity_(std::max<size_t>(capacity, 1)) {
+    }
+
+    [[nodiscard]] std::pair<cost_t, uint64_t> query(const position_t start, const position_t end) {
+        const auto backward = reverse_field(end);
+        return board_.solve_query(start, *backward);
+    }
+
+    [[nodiscard]] uint64_t hits() const { return hits_; }
+    [[nodiscard]] uint64_t misses() const { return misses_; }
+
+private:
+    typedef std::shared_ptr<const std::vector<cost_t> > field_t;
+
+    struct entry_t {
+        std::shared_future<field_t> field;
+        std::list<node_t>::iterator order;
+    };
+
+    [[nodiscard]] field_t reverse_field(const position_t end) {
+        const auto key = make_node(end.x, end.y);
+        std::promise<field_t> promise{};
+        std::shared_future<field_t> field{};
+        bool build = false;
+        {
+            std::lock_guard lock(mutex_);
+            if (const auto it = entries_.find(key); it != entries_.end()) {
+                order_.splice(order_.begin(), order_, it->second.order);
+                field = it->second.field;
+                hits_++;
+            } else {
+                field = promise.get_future().share();
+                order_.push_front(key);
+                entries_.emplace(key, entry_t{field, order_.begin()});
+                if (entries_.size() > capacity_) {
+                    entries_.erase(order_.back());
+                    order_.pop_back();
+                }
+                build = true;
+                misses_++;
+            }
+        }
+
+        if (build) {
+            promise.set_value(std::make_shared<const std::vector<cost_t> >(board_.build_reverse_field(end)));
+        }
+        return field.get();
+    }
+
+    const Board &board_;
+    size_t capacity_;
+    std::mutex mutex_{};
+    std::list<node_t> order_{};
+    std::unordered_map<node_t, entry_t> entries_{};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+// Reads "sx sy ex ey" queries from stdin and answers "cost tiles" for each, in input order. Every thread reads its
+// next line itself, so queries keep flowing while others are being solved; answers wait in `pending` for their turn.
+void serve_queries(const Board &board, const size_t cache_capacity, const size_t thread_count) {
+    RouteService service(board, cache_capacity);
+    std::mutex input_mutex{}, output_mutex{};
+    uint64_t next_query = 0;
+    uint64_t next_output = 0;
+    std::map<uint64_t, std::string> pending{};
+
+    auto worker = [&] {
+        std::string line;
+        while (true) {
+            uint64_t query;
+            {
+                std::lock_guard lock(input_mutex);
+                if (!std::getline(std::cin, line)) {
+                    return;
+                }
+                query = next_query++;
+            }
+
+            std::istringstream stream(line);
+            position_t start{}, end{};
+            char answer[64];
+            if (!(stream >> start.x >> start.y >> end.x >> end.y)) {
+                snprintf(answer, sizeof(answer), "error: expected 'sx sy ex ey'\n");
+            } else if (board.is_wall(start.x, start.y) || board.is_wall(end.x, end.y)) {
+                snprintf(answer, sizeof(answer), "error: start or end is not an open cell\n");
+            } else {
+                const auto [cost, tiles] = service.query(start, end);
+                snprintf(answer, sizeof(answer), "%" PRIu64 " %" PRIu64 "\n", cost, tiles);
+            }
+
+            std::lock_guard lock(output_mutex);
+            pending.emplace(query, answer);
+            for (auto it = pending.begin(); it != pending.end() && it->first == next_output; next_output++) {
+                fputs(it->second.c_str(), stdout);
+                it = pending.erase(it);
+            }
+            fflush(stdout);
+        }
+    };
+
+    std::vector<std::thread> threads{};
+    for (size_t i = 0; i < std::max<size_t>(thread_count, 1); i++) {
+        threads.emplace_back(worker);
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    fprintf(stderr, "queries: %" PRIu64 ", reverse fields cached %" PRIu64 ", built %" PRIu64 "\n", next_query,
+            service.hits(), service.misses());
+}
+
+template<typename T>
+double time_ms(T &&callback) {
+    const auto start = std::chrono::steady_clock::now();
+    callback();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Compare the hash map search against the dense one.
+template<typename T>
+bool same_search(const Board &board, const T &expected, const search_t &actual) {
+    const auto &[costs, parents] = expected;
+    const auto reached = std::ranges::count_if(actual.costs, [](const cost_t cost) { return cost != kUnreached; });
+    if (static_cast<size_t>(reached) != costs.size()) {
+        return false;
+    }
+
+    for (const auto &[node, cost]: costs) {
+        const auto state = board.state_of(node);
+        if (cost != actual.costs[state]) {
+            return false;
+        }
+
+        std::vector<node_t> lhs{};
+        if (const auto parent_it = parents.find(node); parent_it != parents.end()) {
+            lhs = parent_it->second;
+        }
+        std::vector<node_t> rhs{};
+        for (const auto parent_node: parent_nodes(node, actual.parents[state])) {
+            if (parent_node != kNoParent) {
+                rhs.push_back(parent_node);
+            }
+        }
+        std::ranges::sort(lhs);
+        std::ranges::sort(rhs);
+        if (lhs != rhs) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void run_benchmark(const Board &board) {
+    constexpr int kRounds = 20;
+
+    decltype(board.build_spfa()) spfa{};
+    search_t dijkstra(0);
+    const auto spfa_ms = time_ms([&] {
+        for (int i = 0; i < kRounds; i++) {
+            spfa = board.build_spfa();
+        }
+    });
+    const auto dijkstra_ms = time_ms([&] {
+        for (int i = 0; i < kRounds; i++) {
+            dijkstra = board.build_dijkstra();
+        }
+    });
+
+    printf("bench: spfa=%.3fms, dijkstra=%.3fms, costs/parents %s\n", spfa_ms / kRounds, dijkstra_ms / kRounds,
+           same_search(board, spfa, dijkstra) ? "ok" : "MISMATCH");
+
+    std::pair<cost_t, uint64_t> parents_result{}, fields_result{};
+    const auto parents_ms = time_ms([&] {
+        for (int i = 0; i < kRounds; i++) {
+            parents_result = board.solve();
+        }
+    });
+    const auto fields_ms = time_ms([&] {
+        for (int i = 0; i < kRounds; i++) {
+            fields_result = board.solve_fields();
+        }
+    });
+    printf("bench: solve (parents)=%.3fms, solve (fields)=%.3fms, result %s\n", parents_ms / kRounds,
+           fields_ms / kRounds, parents_result == fields_result ? "ok" : "MISMATCH");
+
+    std::pair<cost_t, uint64_t> junctions_result{};
+    size_t junction_states = 0;
+    const auto junctions_ms = time_ms([&] {
+        for (int i = 0; i < kRounds; i++) {
+            const JunctionGraph graph(board);
+            junction_states = graph.state_count();
+            junctions_result = graph.solve();
+        }
+    });
+    printf("bench: solve (junctions)=%.3fms, states %zu -> %zu, result %s\n", junctions_ms / kRounds,
+           board.state_count(), junction_states, parents_result == junctions_result ? "ok" : "MISMATCH");
+
+    uint64_t dijkstra_expanded = 0, astar_expanded = 0, bidirectional_expanded = 0;
+    std::pair<cost_t, uint64_t> astar_result{}, bidirectional_result{};
+    const auto dijkstra_solve_ms = time_ms([&] {
+        for (int i = 0; i < kRounds; i++) {
+            parents_result = board.solve(&dijkstra_expanded);
+        }
+    });
+    const auto astar_ms = time_ms([&] {
+        for (int i = 0; i < kRounds; i++) {
+            astar_result = board.solve_astar(&astar_expanded);
+        }
+    });
+    const auto bidirectional_ms = time_ms([&] {
+        for (int i = 0; i < kRounds; i++) {
+            bidirectional_result = board.solve_bidirectional(&bidirectional_expanded);
+        }
+    });
+    printf("bench: expanded states dijkstra=%" PRIu64 " (%.3fms), a*=%" PRIu64 " (%.3fms, %s), "
+           "bidirectional=%" PRIu64 " (%.3fms, %s)\n", dijkstra_expanded, dijkstra_solve_ms / kRounds,
+           astar_expanded, astar_ms / kRounds, parents_result == astar_result ? "ok" : "MISMATCH",
+           bidirectional_expanded, bidirectional_ms / kRounds,
+           parents_result == bidirectional_result ? "ok" : "MISMATCH");
+
+    // Random queries between open cells, spread over a few ends so that the cache both hits and misses.
+    constexpr size_t kQueries = 2000;
+    constexpr size_t kEnds = 16;
+    std::mt19937 rng(16);
+    auto random_open_cell = [&] {
+        position_t cell{};
+        do {
+            cell = {static_cast<uint32_t>(rng() % board.width()), static_cast<uint32_t>(rng() % board.height())};
+        } while (board.is_wall(cell.x, cell.y));
+        return cell;
+    };
+    std::vector<position_t> ends{};
+    for (size_t i = 0; i < kEnds; i++) {
+        ends.push_back(random_open_cell());
+    }
+    std::vector<std::pair<position_t, position_t> > queries{{board.start(), board.end()}};
+    while (queries.size() < kQueries) {
+        queries.emplace_back(random_open_cell(), ends[rng() % kEnds]);
+    }
+
+    RouteService service(board, kEnds);
+    const size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    std::pair<cost_t, uint64_t> service_result{};
+    std::atomic<size_t> next_query{0};
+    const auto service_ms = time_ms([&] {
+        std::vector<std::thread> threads{};
+        for (size_t t = 0; t < thread_count; t++) {
+            threads.emplace_back([&] {
+                for (size_t i; (i = next_query++) < queries.size();) {
+                    const auto result = service.query(queries[i].first, queries[i].second);
+                    if (i == 0) {
+                        service_result = result;
+                    }
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    });
+    printf("bench: %zu queries on %zu threads=%.3fms (%.0f/s), fields cached %" PRIu64 ", built %" PRIu64
+           ", result %s\n", kQueries, thread_count, service_ms, kQueries * 1000.0 / service_ms, service.hits(),
+           service.misses(), parents_result == service_result ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char **argv) {
+    bool bench = false;
+    bool stats = false;
+    bool fields = false;
+    bool junctions = false;
+    bool queries = false;
+    bool astar = false;
+    bool bidirectional = false;
+    size_t cache_capacity = 64;
+    size_t thread_count = std::thread::hardware_concurrency();
+    const char *input_file_path = "sample.txt";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--fields") == 0) {
+            fields = true;
+        } else if (strcmp(argv[i], "--junctions") == 0) {
+            junctions = true;
+        } else if (strcmp(argv[i], "--astar") == 0) {
+            astar = true;
+        } else if (strcmp(argv[i], "--bidirectional") == 0) {
+            bidirectional = true;
+        } else if (strcmp(argv[i], "--queries") == 0) {
+            queries = true;
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_capacity = std::stoull(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = std::stoull(argv[++i]);
+        } else {
+            input_file_path = argv[i];
+        }
+    }
+
     std::ifstream ifs(input_file_path);
     if (!ifs.is_open()) {
         printf("error: unable to open file %s\n", input_file_path);
@@ -192,9 +1250,36 @@ int main(const int argc, char **argv) {
     ifs.read(input.data(), static_cast<std::streamsize>(input.size()));
 
     const Board board(input);
-    const auto [p1, p2] = board.solve();
-    printf("p1: %u\n", p1);
-    printf("p2: %u\n", p2);
+    if (bench) {
+        run_benchmark(board);
+        return 0;
+    }
+
+    if (queries) {
+        serve_queries(board, cache_capacity, thread_count);
+        return 0;
+    }
+
+    uint64_t expanded = 0;
+    std::pair<cost_t, uint64_t> result{};
+    if (junctions) {
+        result = JunctionGraph(board).solve();
+    } else if (fields) {
+        result = board.solve_fields();
+    } else if (astar) {
+        result = board.solve_astar(&expanded);
+    } else if (bidirectional) {
+        result = board.solve_bidirectional(&expanded);
+    } else {
+        result = board.solve(&expanded);
+    }
+    if (stats && expanded > 0) {
+        fprintf(stderr, "expanded states: %" PRIu64 "\n", expanded);
+    }
+
+    const auto [p1, p2] = result;
+    printf("p1: %" PRIu64 "\n", p1);
+    printf("p2: %" PRIu64 "\n", p2);
 
     return 0;
 }
@@ -1,18 +1,48 @@
-#include <regex>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <bit>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <deque>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
 #include <span>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
-uint64_t pack(const uint8_t shifts, const uint64_t value) {
-    return shifts | value << 8;
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Digits kept by `pack`: the low 8 bits hold the shift count, which leaves 56 bits, 18 whole 3-bit digits.
+constexpr uint64_t kPackedDigits = 18;
+
+// The shift count saturates at 0xFF, so output too long for `value` never looks short.
+uint64_t pack(const uint64_t shifts, const uint64_t value) {
+    return std::min<uint64_t>(shifts, 0xFF) | value << 8;
 }
 
 void unpack(const uint64_t packed, uint8_t &shifts, uint64_t &value) {
@@ -34,7 +64,75 @@ namespace Jixun::AoC2024D17::Simulation {
     constexpr size_t kRegB = 1;
     constexpr size_t kRegC = 2;
 
-    uint64_t run_ex(const std::span<uint8_t> program, const uint64_t valueA = 0, const uint64_t valueB = 0,
+    // Register type of the wide interpreter (`Program::run_digits` and `Program::run_matches`).
+    typedef unsigned __int128 wide_t;
+
+    // Output sinks for `Program::execute`: each takes one digit and returns false to stop the program.
+
+    // Collects digits into one `uint64_t`, 3 bits each. `pack` keeps the first `kPackedDigits`, later ones are dropped.
+    struct PackedOutput {
+        uint64_t result{0};
+        int bits{0};
+
+        bool operator()(const uint8_t digit) {
+            if (bits < 64) {
+                result |= static_cast<uint64_t>(digit) << bits;
+            }
+            bits += 3;
+            return true;
+        }
+    };
+
+    // Appends every digit to `digits`.
+    struct DigitOutput {
+        std::vector<uint8_t> &digits;
+
+        bool operator()(const uint8_t digit) {
+            digits.push_back(digit);
+            return true;
+        }
+    };
+
+    // Compares digits against `target` as they come, stopping at the first wrong or extra one.
+    struct MatchOutput {
+        std::span<const uint8_t> target;
+        size_t matched{0};
+        bool mismatch{false};
+
+        bool operator()(const uint8_t digit) {
+            if (matched == target.size() || target[matched] != digit) {
+                mismatch = true;
+                return false;
+            }
+            matched++;
+            return true;
+        }
+
+        [[nodiscard]] bool complete() const {
+            return !mismatch && matched == target.size();
+        }
+    };
+
+    // `run_ex` of an ahead-of-time compiled program, see `NativeProgram`.
+    typedef uint64_t (*native_run_ex_t)(uint64_t valueA, uint64_t valueB, uint64_t valueC);
+
+    // Candidates evaluated together by `Program::run_ex_lanes`, one per 64-bit AVX2 lane (two vectors).
+    constexpr size_t kLanes = 8;
+
+    // What `Program::analyse` derives from a loop-shaped program: every iteration shifts A right by `shift`, writes
+    // `outputs` digits, and output `i` only depends on the low `output_deps[i]` bits of A at the iteration start.
+    // `window` is the widest of those. `error` says why a program is not supported (empty when it is).
+    struct LoopShape {
+        uint64_t shift{0};
+        uint64_t outputs{0};
+        uint64_t window{0};
+        std::vector<uint64_t> output_deps{};
+        std::string error{};
+    };
+
+    // Reference interpreter: decodes every instruction as it goes. Kept for `--bench`, see `Program` for the one
+    // used by the solver.
+    uint64_t run_ex(const std::span<const uint8_t> program, const uint64_t valueA = 0, const uint64_t valueB = 0,
                     const uint64_t valueC = 0) {
         using namespace Jixun::AoC2024D17::Simulation;
         uint64_t result{0};
@@ -62,7 +160,7 @@ namespace Jixun::AoC2024D17::Simulation {
                     break;
 
                 case kInstBXL:
-                    regs[kRegB] ^= read_operand(program[pc++]);
+                    regs[kRegB] ^= program[pc++]; // literal operand
                     break;
 
                 case kInstBXC:
@@ -75,7 +173,7 @@ namespace Jixun::AoC2024D17::Simulation {
                     break;
 
                 case kInstJNZ:
-                    pc = regs[kRegA] ? read_operand(program[pc]) : pc + 1;
+                    pc = regs[kRegA] ? program[pc] : pc + 1; // literal operand
                     break;
 
                 case kInstOUT:
@@ -94,109 +192,1501 @@ namespace Jixun::AoC2024D17::Simulation {
     }
 
 
-    uint64_t run(const std::span<uint8_t> program, const uint64_t valueA = 0, const uint64_t valueB = 0,
-                 const uint64_t valueC = 0) {
-        uint64_t result{0};
-        uint8_t bits{0};
-        unpack(run_ex(program, valueA, valueB, valueC), bits, result);
-        return result;
+    // The program decoded once: one `Op` per byte offset (so any jump target lands on an op), with the operand
+    // already resolved to an immediate or a register. Handlers are specialised per operand kind and executed with
+    // direct threading: each handler jumps straight to the next one (computed goto), instead of going back through
+    // a single `switch`. `bxl` and `jnz` take literal operands, not combo ones.
+    class Program {
+    public:
+        explicit Program(const std::span<const uint8_t> program) : ops_(program.size() + 2) {
+            for (size_t pc = 0; pc < program.size(); pc++) {
+                ops_[pc] = decode(program, pc);
+            }
+            // Falling off the end (from either parity) halts.
+            ops_[program.size()] = {kOpHalt, 0, 0};
+            ops_[program.size() + 1] = {kOpHalt, 0, 0};
+        }
+
+        // Same result as `Simulation::run_ex`: packed (output bits, output digits), UINT64_MAX on invalid programs.
+        // Only the first `kPackedDigits` digits fit, see `run_digits` for longer output.
+        [[nodiscard]] uint64_t run_ex(const uint64_t valueA = 0, const uint64_t valueB = 0,
+                                      const uint64_t valueC = 0) const {
+            if (native_ != nullptr) {
+                return native_(valueA, valueB, valueC);
+            }
+            PackedOutput output{};
+            if (!execute<uint64_t, false>(valueA, valueB, valueC, output, nullptr)) {
+                return UINT64_MAX;
+            }
+            return pack(output.bits, output.result);
+        }
+
+        // `run_ex`, also adding the number of executed instructions to `instructions`.
+        [[nodiscard]] uint64_t run_counted(const uint64_t valueA, const uint64_t valueB, const uint64_t valueC,
+                                           uint64_t &instructions) const {
+            PackedOutput output{};
+            if (!execute<uint64_t, true>(valueA, valueB, valueC, output, &instructions)) {
+                return UINT64_MAX;
+            }
+            return pack(output.bits, output.result);
+        }
+
+        // Runs with 128-bit registers and appends every output digit to `digits`. False on invalid programs.
+        bool run_digits(const wide_t valueA, const wide_t valueB, const wide_t valueC,
+                        std::vector<uint8_t> &digits) const {
+            DigitOutput output{digits};
+            return execute<wide_t, false>(valueA, valueB, valueC, output, nullptr);
+        }
+
+        // Runs with `Reg` registers (`uint64_t` or `wide_t`) until the output leaves `target`. True when it outputs
+        // exactly `target`.
+        template<typename Reg>
+        [[nodiscard]] bool run_matches(const Reg valueA, const std::span<const uint8_t> target) const {
+            MatchOutput output{target};
+            return execute<Reg, false>(valueA, 0, 0, output, nullptr) && output.complete();
+        }
+
+        [[nodiscard]] uint64_t run(const uint64_t valueA = 0, const uint64_t valueB = 0,
+                                   const uint64_t valueC = 0) const {
+            uint64_t result{0};
+            uint8_t bits{0};
+            unpack(run_ex(valueA, valueB, valueC), bits, result);
+            return result;
+        }
+
+        // `run_ex` for `kLanes` values of A at once (B = C = 0), see `execute_lanes`.
+        [[nodiscard]] std::array<uint64_t, kLanes> run_ex_lanes(const std::array<uint64_t, kLanes> &valuesA) const {
+#if defined(__AVX2__)
+            if (native_ == nullptr) {
+                return execute_lanes(valuesA);
+            }
+#endif
+            std::array<uint64_t, kLanes> results{};
+            for (size_t lane = 0; lane < kLanes; lane++) {
+                results[lane] = run_ex(valuesA[lane]);
+            }
+            return results;
+        }
+
+        // Hands `run_ex` and `run_ex_lanes` over to a compiled version of the same program. The 128-bit runs and
+        // `run_counted` keep using the interpreter.
+        void attach_native(const native_run_ex_t native) {
+            native_ = native;
+        }
+
+        // Static analysis for `reverse_search`. The program must be one loop: straight-line code ending in `jnz 0`,
+        // that shifts A right by a constant, and only reads B and C after writing them. Every register is tracked as
+        // "the low n bits depend on the low max(base, shift + n) bits of A", and at most `bits` bits wide.
+        [[nodiscard]] LoopShape analyse() const {
+            struct reg_t {
+                bool written;
+                uint64_t base;
+                int64_t shift; // -1: only `base` matters
+                uint64_t bits;
+            };
+            constexpr uint64_t kMaxWindow = 24;
+            constexpr char kRegNames[] = "ABC";
+
+            LoopShape shape{};
+            reg_t regs[3] = {{true, 0, 0, 64}, {false, 0, -1, 0}, {false, 0, -1, 0}};
+            bool exact_shift = true; // A is still exactly "A >> regs[kRegA].shift"
+            const size_t size = ops_.size() - 2;
+
+            auto fail = [&](std::string error) {
+                shape.error = std::move(error);
+                return shape;
+            };
+            auto depends = [](const reg_t &reg, const uint64_t n) -> uint64_t {
+                const auto low = std::min(n, reg.bits);
+                return reg.shift < 0 ? reg.base : std::max(reg.base, static_cast<uint64_t>(reg.shift) + low);
+            };
+            // A shifted right by the immediate, or by a register operand up to its largest value.
+            auto shift_a = [&](const Op &op, reg_t &out) -> bool {
+                const auto &a = regs[kRegA];
+                if (op.handler % 2 == 0) {
+                    out = {true, a.base, a.shift < 0 ? -1 : a.shift + static_cast<int64_t>(op.imm),
+                           a.bits - std::min(a.bits, op.imm)};
+                    return true;
+                }
+                const auto &amount = regs[op.reg];
+                if (!amount.written || amount.bits > 6) {
+                    return false;
+                }
+                out = {true, std::max(a.base, depends(amount, amount.bits)),
+                       a.shift < 0 ? -1 : a.shift + (int64_t{1} << amount.bits) - 1, a.bits};
+                return true;
+            };
+
+            if (size % 2 != 0) {
+                return fail("odd program length");
+            }
+            for (size_t pc = 0; pc < size; pc += 2) {
+                const auto &op = ops_[pc];
+                const auto reads = [&](const size_t reg) { return regs[reg].written; };
+                switch (op.handler) {
+                    case kOpAdvImm:
+                    case kOpAdvReg:
+                        if (op.handler == kOpAdvReg) {
+                            exact_shift = false;
+                        }
+                        [[fallthrough]];
+                    case kOpBdvImm:
+                    case kOpBdvReg:
+                    case kOpCdvImm:
+                    case kOpCdvReg: {
+                        reg_t shifted{};
+                        if (!shift_a(op, shifted)) {
+                            return fail(std::string("shift by register ") + kRegNames[op.reg] + " is unbounded");
+                        }
+                        regs[(op.handler - kOpAdvImm) / 2] = shifted;
+                        break;
+                    }
+                    case kOpBxl:
+                        if (!reads(kRegB)) {
+                            return fail("bxl reads B before it is written");
+                        }
+                        regs[kRegB].bits = std::max<uint64_t>(regs[kRegB].bits, std::bit_width(op.imm));
+                        break;
+                    case kOpBstImm:
+                        regs[kRegB] = {true, 0, -1, static_cast<uint64_t>(std::bit_width(op.imm & 7))};
+                        break;
+                    case kOpBstReg:
+                        if (!reads(op.reg)) {
+                            return fail(std::string("bst reads ") + kRegNames[op.reg] + " before it is written");
+                        }
+                        regs[kRegB] = {true, depends(regs[op.reg], 3), -1, std::min<uint64_t>(regs[op.reg].bits, 3)};
+                        break;
+                    case kOpBxc: {
+                        if (!reads(kRegB) || !reads(kRegC)) {
+                            return fail("bxc reads B or C before it is written");
+                        }
+                        const auto &b = regs[kRegB], &c = regs[kRegC];
+                        regs[kRegB] = {true, std::max(b.base, c.base), std::max(b.shift, c.shift),
+                                       std::max(b.bits, c.bits)};
+                        break;
+                    }
+                    case kOpOutImm:
+                        shape.output_deps.push_back(0);
+                        break;
+                    case kOpOutReg:
+                        if (!reads(op.reg)) {
+                            return fail(std::string("out reads ") + kRegNames[op.reg] + " before it is written");
+                        }
+                        shape.output_deps.push_back(depends(regs[op.reg], 3));
+                        break;
+                    case kOpJnz:
+                        if (pc + 2 != size || op.imm != 0) {
+                            return fail("jnz must be the last instruction and jump back to 0");
+                        }
+                        break;
+                    default:
+                        return fail("invalid instruction");
+                }
+            }
+
+            if (size == 0 || ops_[size - 2].handler != kOpJnz) {
+                return fail("the program does not end with jnz 0");
+            }
+            const auto &a = regs[kRegA];
+            if (!exact_shift || a.base != 0 || a.shift <= 0) {
+                return fail("A is not shifted right by a constant every iteration");
+            }
+            if (shape.output_deps.empty()) {
+                return fail("the loop has no output");
+            }
+            // The search compares each iteration's outputs in packed form.
+            if (shape.output_deps.size() > kPackedDigits) {
+                return fail("more than " + std::to_string(kPackedDigits) + " outputs per iteration");
+            }
+
+            shape.shift = static_cast<uint64_t>(a.shift);
+            shape.outputs = shape.output_deps.size();
+            shape.window = *std::ranges::max_element(shape.output_deps);
+            if (shape.window > kMaxWindow) {
+                return fail("an output depends on more than " + std::to_string(kMaxWindow) + " bits of A");
+            }
+            return shape;
+        }
+
+    private:
+        // Handlers: `*_IMM` take the immediate, `*_REG` read `regs[reg]`.
+        enum : uint8_t {
+            kOpAdvImm, kOpAdvReg, kOpBdvImm, kOpBdvReg, kOpCdvImm, kOpCdvReg,
+            kOpBxl, kOpBstImm, kOpBstReg, kOpJnz, kOpBxc, kOpOutImm, kOpOutReg,
+            kOpHalt, kOpInvalid, kOpCount,
+        };
+
+        struct Op {
+            uint8_t handler;
+            uint8_t reg;
+            uint64_t imm; // literal, combo 0..3, or the jump target (clamped to the halt op)
+        };
+
+        [[nodiscard]] static Op decode(const std::span<const uint8_t> program, const size_t pc) {
+            if (pc + 1 >= program.size()) {
+                return {kOpHalt, 0, 0}; // the operand would be past the end
+            }
+            const uint8_t operand = program[pc + 1];
+
+            // Combo operand: 0..3 are literals, 4..6 registers A, B, C, 7 is reserved.
+            auto combo = [&](const uint8_t imm_handler) -> Op {
+                if (operand <= 3) {
+                    return {imm_handler, 0, operand};
+                }
+                if (operand <= 6) {
+                    return {static_cast<uint8_t>(imm_handler + 1), static_cast<uint8_t>(operand - 4), 0};
+                }
+                return {kOpInvalid, 0, 0};
+            };
+
+            switch (program[pc]) {
+                case kInstADV:
+                    return combo(kOpAdvImm);
+                case kInstBDV:
+                    return combo(kOpBdvImm);
+                case kInstCDV:
+                    return combo(kOpCdvImm);
+                case kInstBXL:
+                    return {kOpBxl, 0, operand};
+                case kInstBST:
+                    return combo(kOpBstImm);
+                case kInstJNZ:
+                    return {kOpJnz, 0, std::min<uint64_t>(operand, program.size())};
+                case kInstBXC:
+                    return {kOpBxc, 0, 0};
+                case kInstOUT:
+                    return combo(kOpOutImm);
+                default:
+                    return {kOpInvalid, 0, 0};
+            }
+        }
+
+        // Register operands can be anything, shifting by the register width or more is undefined.
+        template<typename Reg>
+        static Reg shift_right(const Reg value, const Reg amount) {
+            return amount < sizeof(Reg) * 8 ? value >> amount : 0;
+        }
+
+        // Runs the program on `Reg` registers, passing every output digit to `output` until it returns false.
+        // Returns false on an invalid opcode or operand.
+        template<typename Reg, bool kCount, typename Sink>
+        bool execute(const Reg valueA, const Reg valueB, const Reg valueC, Sink &output,
+                     uint64_t *instructions) const {
+            Reg regs[3] = {valueA, valueB, valueC};
+            uint64_t executed{0};
+            const Op *op = ops_.data();
+
+            // Labels as values (GNU extension, g++ and clang): every handler ends with its own indirect jump.
+            static constexpr void *kHandlers[kOpCount] = {
+                &&adv_imm, &&adv_reg, &&bdv_imm, &&bdv_reg, &&cdv_imm, &&cdv_reg,
+                &&bxl, &&bst_imm, &&bst_reg, &&jnz, &&bxc, &&out_imm, &&out_reg,
+                &&halt, &&invalid,
+            };
+#define DISPATCH() \
+            do { \
+                if constexpr (kCount) executed++; \
+                goto *kHandlers[op->handler]; \
+            } while (0)
+#define NEXT() \
+            do { \
+                op += 2; \
+                DISPATCH(); \
+            } while (0)
+
+            DISPATCH();
+
+        adv_imm:
+            regs[kRegA] >>= op->imm;
+            NEXT();
+        adv_reg:
+            regs[kRegA] = shift_right(regs[kRegA], regs[op->reg]);
+            NEXT();
+        bdv_imm:
+            regs[kRegB] = regs[kRegA] >> op->imm;
+            NEXT();
+        bdv_reg:
+            regs[kRegB] = shift_right(regs[kRegA], regs[op->reg]);
+            NEXT();
+        cdv_imm:
+            regs[kRegC] = regs[kRegA] >> op->imm;
+            NEXT();
+        cdv_reg:
+            regs[kRegC] = shift_right(regs[kRegA], regs[op->reg]);
+            NEXT();
+        bxl:
+            regs[kRegB] ^= op->imm;
+            NEXT();
+        bst_imm:
+            regs[kRegB] = op->imm;
+            NEXT();
+        bst_reg:
+            regs[kRegB] = regs[op->reg] % 8;
+            NEXT();
+        jnz:
+            if (regs[kRegA]) {
+                op = ops_.data() + op->imm;
+                DISPATCH();
+            }
+            NEXT();
+        bxc:
+            regs[kRegB] ^= regs[kRegC];
+            NEXT();
+        out_imm:
+            if (!output(static_cast<uint8_t>(op->imm & 7))) {
+                goto halt;
+            }
+            NEXT();
+        out_reg:
+            if (!output(static_cast<uint8_t>(regs[op->reg] & 7))) {
+                goto halt;
+            }
+            NEXT();
+        invalid:
+            return false; // invalid opcode or operand
+        halt:
+            if constexpr (kCount) {
+                // The halt op is not part of the program.
+                *instructions += executed - 1;
+            }
+#undef DISPATCH
+#undef NEXT
+
+            return true;
+        }
+
+#if defined(__AVX2__)
+        // Every lane runs the same instruction: the program only branches at `jnz`. When lanes disagree on a jump
+        // whose fall-through is the end of the program (the loop shape), the lanes that fall through halt and are
+        // masked out of later output. Any other disagreement finishes the batch with the scalar interpreter.
+        // Lanes are held in `kVectors` independent AVX2 vectors of 4, so their dependency chains overlap.
+        [[nodiscard]] std::array<uint64_t, kLanes> execute_lanes(const std::array<uint64_t, kLanes> &valuesA) const {
+            constexpr size_t kVectors = kLanes / 4;
+            static_assert(kLanes % 4 == 0);
+
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i seven = _mm256_set1_epi64x(7);
+            __m256i regs[3][kVectors];
+            __m256i result[kVectors];
+            __m256i active_mask[kVectors];
+            for (size_t v = 0; v < kVectors; v++) {
+                regs[kRegA][v] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(valuesA.data() + v * 4));
+                regs[kRegB][v] = zero;
+                regs[kRegC][v] = zero;
+                result[v] = zero;
+                active_mask[v] = _mm256_set1_epi64x(-1);
+            }
+
+            // Lane bit masks (bit i = lane i), built from `_mm256_movemask_pd`.
+            constexpr uint32_t kAllLanes = (1u << kLanes) - 1;
+            uint32_t active = kAllLanes;
+            std::array<uint64_t, kLanes> lane_bits{};
+            std::array<uint64_t, kLanes> results{};
+
+            int bits{0};
+            auto halt_lanes = [&](const uint32_t lanes) {
+                for (size_t lane = 0; lane < kLanes; lane++) {
+                    if (lanes >> lane & 1) {
+                        lane_bits[lane] = bits;
+                    }
+                }
+            };
+            auto output = [&](const __m256i digits, const size_t v) {
+                const auto shifted = _mm256_sll_epi64(_mm256_and_si256(digits, active_mask[v]),
+                                                      _mm_cvtsi32_si128(bits));
+                result[v] = _mm256_or_si256(result[v], shifted);
+            };
+            // `*dv` handlers come in (immediate, register) pairs starting at an even index.
+            auto shift = [&](const Op *op, const size_t v) {
+                return op->handler % 2 == 0
+                           ? _mm256_srl_epi64(regs[kRegA][v], _mm_cvtsi64_si128(static_cast<int64_t>(op->imm)))
+                           : _mm256_srlv_epi64(regs[kRegA][v], regs[op->reg][v]);
+            };
+
+            for (const Op *op = ops_.data(); active != 0;) {
+                switch (op->handler) {
+                    case kOpAdvImm:
+                    case kOpAdvReg:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            regs[kRegA][v] = shift(op, v);
+                        }
+                        break;
+                    case kOpBdvImm:
+                    case kOpBdvReg:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            regs[kRegB][v] = shift(op, v);
+                        }
+                        break;
+                    case kOpCdvImm:
+                    case kOpCdvReg:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            regs[kRegC][v] = shift(op, v);
+                        }
+                        break;
+                    case kOpBxl:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            regs[kRegB][v] = _mm256_xor_si256(regs[kRegB][v],
+                                                              _mm256_set1_epi64x(static_cast<int64_t>(op->imm)));
+                        }
+                        break;
+                    case kOpBstImm:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            regs[kRegB][v] = _mm256_set1_epi64x(static_cast<int64_t>(op->imm));
+                        }
+                        break;
+                    case kOpBstReg:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            regs[kRegB][v] = _mm256_and_si256(regs[op->reg][v], seven);
+                        }
+                        break;
+                    case kOpBxc:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            regs[kRegB][v] = _mm256_xor_si256(regs[kRegB][v], regs[kRegC][v]);
+                        }
+                        break;
+                    case kOpOutImm:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            output(_mm256_set1_epi64x(static_cast<int64_t>(op->imm & 7)), v);
+                        }
+                        bits += 3;
+                        break;
+                    case kOpOutReg:
+                        for (size_t v = 0; v < kVectors; v++) {
+                            output(_mm256_and_si256(regs[op->reg][v], seven), v);
+                        }
+                        bits += 3;
+                        break;
+                    case kOpJnz: {
+                        __m256i is_zero[kVectors];
+                        uint32_t jumping = 0;
+                        for (size_t v = 0; v < kVectors; v++) {
+                            is_zero[v] = _mm256_cmpeq_epi64(regs[kRegA][v], zero);
+                            jumping |= static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(is_zero[v])))
+                                    << (v * 4);
+                        }
+                        jumping = ~jumping & active;
+                        if (jumping == active) {
+                            op = ops_.data() + op->imm;
+                            continue;
+                        }
+                        if (jumping != 0) {
+                            if (op[2].handler != kOpHalt) {
+                                for (size_t lane = 0; lane < kLanes; lane++) {
+                                    results[lane] = run_ex(valuesA[lane]);
+                                }
+                                return results;
+                            }
+                            halt_lanes(active & ~jumping);
+                            active = jumping;
+                            for (size_t v = 0; v < kVectors; v++) {
+                                active_mask[v] = _mm256_andnot_si256(is_zero[v], active_mask[v]);
+                            }
+                            op = ops_.data() + op->imm;
+                            continue;
+                        }
+                        break;
+                    }
+                    case kOpHalt:
+                        halt_lanes(active);
+                        active = 0;
+                        continue;
+                    default: {
+                        // Invalid instruction: every lane still running fails like `run_ex`.
+                        for (size_t v = 0; v < kVectors; v++) {
+                            _mm256_storeu_si256(reinterpret_cast<__m256i *>(results.data() + v * 4), result[v]);
+                        }
+                        for (size_t lane = 0; lane < kLanes; lane++) {
+                            results[lane] = active >> lane & 1 ? UINT64_MAX : pack(lane_bits[lane], results[lane]);
+                        }
+                        return results;
+                    }
+                }
+                op += 2;
+            }
+
+            for (size_t v = 0; v < kVectors; v++) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(results.data() + v * 4), result[v]);
+            }
+            for (size_t lane = 0; lane < kLanes; lane++) {
+                results[lane] = pack(lane_bits[lane], results[lane]);
+            }
+            return results;
+        }
+#endif
+
+        std::vector<Op> ops_;
+        native_run_ex_t native_{nullptr};
+    };
+
+    // Ahead-of-time specialisation: the program written out as C++ with every operand resolved, built into a shared
+    // library with the flags of this solution, and loaded. Each instruction becomes one statement on `a`, `b` and
+    // `c`, and `jnz` a `goto`, so the loop body is straight-line code for the compiler to fold. Libraries are cached
+    // by program in a per-user directory, and only loaded when this user owns them.
+    class NativeProgram {
+    public:
+        NativeProgram() = default;
+        NativeProgram(const NativeProgram &) = delete;
+        NativeProgram &operator=(const NativeProgram &) = delete;
+
+        ~NativeProgram() {
+            if (handle_ != nullptr) {
+                dlclose(handle_);
+            }
+        }
+
+        // C++ source with `extern "C" uint64_t d17_run_ex(a, b, c)`, same result as `Program::run_ex`. Empty, with
+        // `error` set, for programs that jump to an odd offset.
+        static std::string emit(const std::span<const uint8_t> program, std::string &error) {
+            const size_t size = program.size();
+            std::vector<bool> targets(size + 2);
+            for (size_t pc = 0; pc + 1 < size; pc += 2) {
+                if (program[pc] == kInstJNZ) {
+                    const auto target = std::min<size_t>(program[pc + 1], size);
+                    if (target % 2 != 0 && target < size) {
+                        error = "jnz to odd offset " + std::to_string(target);
+                        return {};
+                    }
+                    targets[target] = true;
+                }
+            }
+
+            auto combo = [](const uint8_t operand) -> std::string {
+                if (operand <= 3) {
+                    return std::to_string(operand);
+                }
+                return std::string(1, "abc"[operand - 4]);
+            };
+            // Literal shifts can not reach 64, register ones might.
+            auto shift = [&](const uint8_t operand) {
+                return operand <= 3 ? "a >> " + combo(operand) : "shr(a, " + combo(operand) + ")";
+            };
+
+            std::ostringstream out;
+            out << "// Generated by aoc-2024/day-17/solve.cpp.\n"
+                    << "#include <cstdint>\n\n"
+                    << "static inline uint64_t shr(const uint64_t value, const uint64_t amount) {\n"
+                    << "    return amount < 64 ? value >> amount : 0;\n"
+                    << "}\n\n"
+                    << "extern \"C\" uint64_t d17_run_ex(uint64_t a, uint64_t b, uint64_t c) {\n"
+                    << "    uint64_t result = 0;\n"
+                    << "    int bits = 0;\n";
+            size_t pc = 0;
+            for (; pc + 1 < size; pc += 2) {
+                if (targets[pc]) {
+                    out << "L" << pc << ":\n";
+                }
+                const auto operand = program[pc + 1];
+                if (operand == 7 && program[pc] != kInstBXL && program[pc] != kInstJNZ && program[pc] != kInstBXC) {
+                    out << "    return UINT64_MAX; // reserved combo operand\n";
+                    continue;
+                }
+                switch (program[pc]) {
+                    case kInstADV:
+                        out << "    a = " << shift(operand) << ";\n";
+                        break;
+                    case kInstBDV:
+                        out << "    b = " << shift(operand) << ";\n";
+                        break;
+                    case kInstCDV:
+                        out << "    c = " << shift(operand) << ";\n";
+                        break;
+                    case kInstBXL:
+                        out << "    b ^= " << static_cast<int>(operand) << ";\n";
+                        break;
+                    case kInstBST:
+                        out << "    b = " << (operand <= 3 ? combo(operand) : combo(operand) + " & 7") << ";\n";
+                        break;
+                    case kInstJNZ:
+                        out << "    if (a) goto L" << std::min<size_t>(operand, size) << ";\n";
+                        break;
+                    case kInstBXC:
+                        out << "    b ^= c;\n";
+                        break;
+                    case kInstOUT:
+                        out << "    if (bits < 64) result |= static_cast<uint64_t>(" << combo(operand)
+                                << " & 7) << bits;\n"
+                                << "    bits += 3;\n";
+                        break;
+                    default:
+                        out << "    return UINT64_MAX; // invalid opcode\n";
+                        break;
+                }
+            }
+            // Jumps past the end land on the return.
+            for (; pc <= size; pc++) {
+                if (targets[pc]) {
+                    out << "L" << pc << ":\n";
+                }
+            }
+            out << "    return static_cast<uint64_t>(bits < 0xFF ? bits : 0xFF) | result << 8;\n"
+                    << "}\n";
+            return out.str();
+        }
+
+        // Emits, builds (unless already cached) and loads the program. False, with `error` set, on failure.
+        bool compile(const std::span<const uint8_t> program, std::string &error) {
+            const auto source = emit(program, error);
+            if (source.empty()) {
+                return false;
+            }
+
+            std::filesystem::path dir{};
+            if (!cache_directory(dir, error)) {
+                return false;
+            }
+            if (dir.string().find('\'') != std::string::npos) {
+                error = "cache directory " + dir.string() + " contains a quote";
+                return false;
+            }
+
+            const auto name = "aoc-2024-d17-" + std::to_string(std::hash<std::string>{}(source));
+            const auto source_path = dir / (name + ".cpp");
+            const auto library_path = dir / (name + ".so");
+
+            if (!std::filesystem::exists(std::filesystem::symlink_status(library_path))) {
+                // Built under names unique to this process, then renamed, so concurrent runs do not collide.
+                const auto suffix = "." + std::to_string(getpid());
+                const auto temp_source = dir / (name + suffix + ".cpp");
+                const auto temp_library = dir / (name + suffix + ".so");
+                if (!write_new_file(temp_source, source, error)) {
+                    return false;
+                }
+                const auto command = "g++ -O2 -Wall -DNDEBUG -std=c++20 -march=native -shared -fPIC -o '" +
+                                     temp_library.string() + "' '" + temp_source.string() + "'";
+                if (std::system(command.c_str()) != 0 || chmod(temp_library.c_str(), 0700) != 0) {
+                    error = "unable to compile " + temp_source.string();
+                    unlink(temp_source.c_str());
+                    unlink(temp_library.c_str());
+                    return false;
+                }
+                if (rename(temp_source.c_str(), source_path.c_str()) != 0 ||
+                    rename(temp_library.c_str(), library_path.c_str()) != 0) {
+                    error = "unable to store " + library_path.string();
+                    return false;
+                }
+            }
+
+            if (!owned_privately(library_path, S_IFREG, error)) {
+                return false;
+            }
+            handle_ = dlopen(library_path.c_str(), RTLD_NOW);
+            if (handle_ == nullptr) {
+                error = dlerror();
+                return false;
+            }
+            run_ex_ = reinterpret_cast<native_run_ex_t>(dlsym(handle_, "d17_run_ex"));
+            if (run_ex_ == nullptr) {
+                error = "d17_run_ex not found in " + library_path.string();
+                return false;
+            }
+            return true;
+        }
+
+        [[nodiscard]] native_run_ex_t run_ex() const {
+            return run_ex_;
+        }
+
+    private:
+        // Per-user cache: `$XDG_CACHE_HOME/aoc-2024-d17`, `~/.cache/aoc-2024-d17`, or a directory named after the
+        // user id in the temporary directory. Created 0700, and only used when nobody else can write to it.
+        static bool cache_directory(std::filesystem::path &dir, std::string &error) {
+            if (const char *cache = getenv("XDG_CACHE_HOME"); cache != nullptr && *cache != '\0') {
+                dir = std::filesystem::path(cache) / "aoc-2024-d17";
+            } else if (const char *home = getenv("HOME"); home != nullptr && *home != '\0') {
+                dir = std::filesystem::path(home) / ".cache" / "aoc-2024-d17";
+            } else {
+                dir = std::filesystem::temp_directory_path() / ("aoc-2024-d17-" + std::to_string(getuid()));
+            }
+
+            std::error_code ec{};
+            std::filesystem::create_directories(dir.parent_path(), ec);
+            if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+                error = "unable to create " + dir.string();
+                return false;
+            }
+            return owned_privately(dir, S_IFDIR, error);
+        }
+
+        // True when `path` is a `type` (never a symlink) owned by this user, and only this user can write to it.
+        static bool owned_privately(const std::filesystem::path &path, const mode_t type, std::string &error) {
+            struct stat st{};
+            if (lstat(path.c_str(), &st) != 0) {
+                error = "unable to stat " + path.string();
+                return false;
+            }
+            if ((st.st_mode & S_IFMT) != type || st.st_uid != getuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+                error = path.string() + " is not private to this user";
+                return false;
+            }
+            return true;
+        }
+
+        // Creates `path` (it must not exist yet, and is never reached through a symlink) with `content`, mode 0600.
+        static bool write_new_file(const std::filesystem::path &path, const std::string &content, std::string &error) {
+            const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+            if (fd < 0) {
+                error = "unable to create " + path.string();
+                return false;
+            }
+            size_t written = 0;
+            while (written < content.size()) {
+                const auto n = write(fd, content.data() + written, content.size() - written);
+                if (n <= 0) {
+                    close(fd);
+                    unlink(path.c_str());
+                    error = "unable to write " + path.string();
+                    return false;
+                }
+                written += static_cast<size_t>(n);
+            }
+            close(fd);
+            return true;
+        }
+
+        void *handle_{nullptr};
+        native_run_ex_t run_ex_{nullptr};
+    };
+}
+
+using Jixun::AoC2024D17::Simulation::wide_t;
+
+struct WideHash {
+    size_t operator()(const wide_t value) const {
+        return std::hash<uint64_t>{}(static_cast<uint64_t>(value) ^ static_cast<uint64_t>(value >> 64) *
+                                     0x9E37'79B9'7F4A'7C15ull);
+    }
+};
+
+std::string to_string(wide_t value, const int base = 10) {
+    std::string result{};
+    do {
+        result.push_back(static_cast<char>('0' + static_cast<int>(value % base)));
+        value /= base;
+    } while (value != 0);
+    std::ranges::reverse(result);
+    return result;
+}
+
+// Target digits that loop iteration `level` must output, packed like `run_ex` output.
+uint64_t expected_digits(const Jixun::AoC2024D17::Simulation::LoopShape &shape, const std::span<const uint8_t> target,
+                         const size_t level) {
+    uint64_t result{0};
+    for (size_t i = 0; i < shape.outputs; i++) {
+        result |= static_cast<uint64_t>(target[shape.outputs * level + i]) << (i * 3);
     }
+    return result;
 }
 
-std::unordered_set<uint64_t> reverse_search(const std::span<uint8_t> program, const uint64_t target_output,
-                                            const uint64_t target_bit_count) {
-    using Jixun::AoC2024D17::Simulation::run;
-    using Jixun::AoC2024D17::Simulation::run_ex;
-    std::unordered_set<uint64_t> results{};
+// Output digits of one loop iteration for every value of the low `shape.window` bits of A, which are all that the
+// iteration reads. Built once with `kLanes` runs at a time, so `scan_window` can look digits up instead of running
+// the program.
+class OutputTable {
+public:
+    // 2^20 entries, 8 MiB.
+    static constexpr uint64_t kMaxWindow = 20;
 
-    // Brute force as the target is too low.
-    if (target_bit_count <= 6) {
-        uint8_t early_bits;
-        uint64_t early_output;
-        for (uint64_t i = 0; i <= 077; i++) {
-            unpack(run_ex(program, i), early_bits, early_output);
-            if (early_output == target_output && early_bits == target_bit_count) {
-                results.insert(i);
+    OutputTable(const Jixun::AoC2024D17::Simulation::Program &program,
+                const Jixun::AoC2024D17::Simulation::LoopShape &shape)
+        : mask_((uint64_t{1} << shape.window) - 1), digits_(size_t{1} << shape.window) {
+        using Jixun::AoC2024D17::Simulation::kLanes;
+        assert(shape.window <= kMaxWindow);
+
+        const uint64_t digit_mask = (uint64_t{1} << shape.outputs * 3) - 1;
+        for (uint64_t i = 0; i < digits_.size(); i += kLanes) {
+            std::array<uint64_t, kLanes> values{};
+            for (size_t lane = 0; lane < kLanes; lane++) {
+                values[lane] = std::min<uint64_t>(i + lane, mask_);
+            }
+            const auto packed = program.run_ex_lanes(values);
+            for (size_t lane = 0; lane < kLanes && i + lane < digits_.size(); lane++) {
+                digits_[i + lane] = packed[lane] >> 8 & digit_mask;
             }
         }
-        return results;
     }
 
-    // value, window_shifts
-    std::deque<uint64_t> work{};
+    // Digits of the iteration that starts with `value` in A, packed like `run_ex` output.
+    [[nodiscard]] uint64_t digits(const uint64_t value) const {
+        return digits_[value & mask_];
+    }
+
+private:
+    uint64_t mask_;
+    std::vector<uint64_t> digits_{};
+};
+
+// Extends `known` (the low bits of A fixed by the levels before `level`) with every value of the bits iteration
+// `level` reads next, bits [shift, shift + window) above the known ones. Calls `on_match` with each candidate whose
+// iteration outputs `expected`. When the window is narrower than the shift, the bits between two windows are never
+// read and stay 0, which keeps the smallest answer. The last level also scans every bit up to the answer limit, as
+// they decide whether the program halts in time. Digits come from `table` when given, otherwise from running the
+// program `kLanes` candidates at a time.
+template<typename F>
+void scan_window(const Jixun::AoC2024D17::Simulation::Program &program,
+                 const Jixun::AoC2024D17::Simulation::LoopShape &shape, const OutputTable *table, const size_t level,
+                 const size_t iterations, const wide_t known, const uint64_t expected, F &&on_match) {
+    using Jixun::AoC2024D17::Simulation::kLanes;
 
-    // Adding all possible base inputs
-    for (uint64_t i = 0; i < 077; i++) {
-        work.emplace_back(pack(0, i));
+    const uint64_t shift = shape.shift * level;
+    // An answer halts after `iterations` loops, so it is below 2^(shape.shift * iterations).
+    const uint64_t limit = shape.shift * iterations;
+    const uint64_t known_bits = level == 0 ? 0 : shift - shape.shift + shape.window;
+    const uint64_t low = std::max(known_bits, shift);
+    const uint64_t high = level + 1 == iterations ? limit : std::min(shift + shape.window, limit);
+    const uint64_t new_bits = high > low ? high - low : 0;
+    const uint64_t digit_mask = (uint64_t{1} << shape.outputs * 3) - 1;
+    const uint64_t count = uint64_t{1} << new_bits;
+
+    if (table != nullptr) {
+        for (uint64_t i = 0; i < count; i++) {
+            const auto candidate = (new_bits == 0 ? 0 : static_cast<wide_t>(i) << low) | known;
+            if (table->digits(static_cast<uint64_t>(candidate >> shift)) == expected) {
+                on_match(candidate);
+            }
+        }
+        return;
+    }
+
+    for (uint64_t i = 0; i < count; i += kLanes) {
+        std::array<wide_t, kLanes> candidates{};
+        std::array<uint64_t, kLanes> iteration_inputs{};
+        for (size_t lane = 0; lane < kLanes; lane++) {
+            const auto bits = new_bits == 0 ? 0 : static_cast<wide_t>(std::min(i + lane, count - 1)) << low;
+            candidates[lane] = bits | known;
+            // The iteration's outputs only read `shape.window` low bits, so 64 of them are plenty.
+            iteration_inputs[lane] = static_cast<uint64_t>(candidates[lane] >> shift);
+        }
+        const auto packed = program.run_ex_lanes(iteration_inputs);
+        for (size_t lane = 0; lane < kLanes && i + lane < count; lane++) {
+            if ((packed[lane] >> 8 & digit_mask) == expected) {
+                on_match(candidates[lane]);
+            }
+        }
     }
+}
+
+// Full-output verification. Calls `on_match` with every candidate that outputs exactly `target`. Batches that fit
+// `run_ex` (64-bit candidates, up to `kPackedDigits` target digits) run `kLanes` at a time, the last batch
+// repeating its final candidate. The rest run one at a time with 128-bit registers, stopping at the first wrong
+// digit.
+template<typename F>
+void verify_candidates(const Jixun::AoC2024D17::Simulation::Program &program, const std::span<const wide_t> complete,
+                       const std::span<const uint8_t> target, F &&on_match) {
+    using Jixun::AoC2024D17::Simulation::kLanes;
 
-    std::unordered_set<uint64_t> visited{};
-    const uint64_t expected_wnd_shifts = (target_bit_count / 3 - 2) * 3;
+    const bool packable = target.size() <= kPackedDigits;
+    uint64_t target_output{0};
+    for (size_t i = 0; packable && i < target.size(); i++) {
+        target_output |= static_cast<uint64_t>(target[i]) << (i * 3);
+    }
+
+    for (size_t i = 0; i < complete.size(); i += kLanes) {
+        const auto batch = complete.subspan(i, std::min(kLanes, complete.size() - i));
+        if (!packable || std::ranges::any_of(batch, [](const wide_t value) { return value >> 64 != 0; })) {
+            for (const auto candidate: batch) {
+                if (program.run_matches(candidate, target)) {
+                    on_match(candidate);
+                }
+            }
+            continue;
+        }
+
+        std::array<uint64_t, kLanes> candidates{};
+        for (size_t lane = 0; lane < kLanes; lane++) {
+            candidates[lane] = static_cast<uint64_t>(batch[std::min(lane, batch.size() - 1)]);
+        }
+        const auto packed = program.run_ex_lanes(candidates);
+        for (size_t lane = 0; lane < batch.size(); lane++) {
+            uint8_t actual_bits;
+            uint64_t actual_output;
+            unpack(packed[lane], actual_bits, actual_output);
+            if (target_output == actual_output && actual_bits == target.size() * 3) {
+                on_match(batch[lane]);
+            }
+        }
+    }
+}
+
+// Number of loop iterations that output `digits` digits, 0 if no whole number of iterations does.
+size_t iteration_count(const Jixun::AoC2024D17::Simulation::LoopShape &shape, const size_t digits) {
+    return digits % shape.outputs == 0 ? digits / shape.outputs : 0;
+}
+
+// `table` is optional, see `scan_window`.
+std::unordered_set<wide_t, WideHash> reverse_search(const Jixun::AoC2024D17::Simulation::Program &program,
+                                                    const Jixun::AoC2024D17::Simulation::LoopShape &shape,
+                                                    const std::span<const uint8_t> target,
+                                                    const OutputTable *table = nullptr) {
+    std::unordered_set<wide_t, WideHash> results{};
+    const auto iterations = iteration_count(shape, target.size());
+    if (iterations == 0) {
+        return results;
+    }
+
+    // level, known low bits of A
+    std::deque<std::pair<size_t, wide_t> > work{{0, 0}};
+
+    std::unordered_set<wide_t, WideHash> visited{}; // values already scanned on `visited_level`
+    size_t visited_level{0};
+    std::vector<wide_t> complete{}; // candidates with every iteration matched, to verify against the whole output
 
-    uint8_t window_shifts;
-    uint64_t test_input;
     for (; !work.empty(); work.pop_front()) {
-        auto compact_input = work.front();
-        unpack(compact_input, window_shifts, test_input);
-        if (visited.contains(compact_input)) {
+        const auto [level, known] = work.front();
+        if (level != visited_level) {
+            visited.clear();
+            visited_level = level;
+        }
+        if (!visited.insert(known).second) {
             continue;
         }
-        visited.insert(compact_input);
 
-        const auto test_input_base = test_input >> window_shifts;
-        const auto expected_digit = static_cast<uint8_t>((target_output >> window_shifts) % 8);
+        const auto expected = expected_digits(shape, target, level);
 
 #ifndef NDEBUG
-        {
-            const auto width = window_shifts / 3 + 2;
-            std::cout << "scan for 0o?" << std::setw(width) << std::setfill('0') << std::oct << test_input
-                    << ", digit = " << static_cast<int>(expected_digit) << "..." << std::endl;
-        }
+        std::cout << "scan for 0o?" << to_string(known, 8) << ", digits = 0o" << std::oct << expected << "..."
+                << std::endl;
 #endif
 
-        // 6-bit + 4-bit search window (0..16)
-        for (uint64_t i = 0; i < 16; ++i) {
-            const uint64_t prefix = i << 6;
-            const auto output = run(program, prefix | test_input_base);
+        scan_window(program, shape, table, level, iterations, known, expected, [&](const wide_t value) {
+            if (level + 1 == iterations) {
+                complete.push_back(value);
+            } else {
+                work.emplace_back(level + 1, value);
+            }
+        });
+    }
 
-            // ReSharper disable once CppTooWideScopeInitStatement
-            const auto actual_digit = static_cast<uint8_t>(output & 7);
+    verify_candidates(program, complete, target, [&](const wide_t value) {
+        results.insert(value);
+    });
 
-            if (expected_digit != actual_digit) {
-                continue;
-            }
+    return results;
+}
+
+// Work list of one `parallel_reverse_search` worker: the owner pops from the back, idle workers steal from the front.
+class WorkDeque {
+public:
+    void push(const wide_t value) {
+        std::lock_guard lock(mutex_);
+        items_.push_back(value);
+    }
+
+    bool pop(wide_t &value) {
+        std::lock_guard lock(mutex_);
+        if (items_.empty()) {
+            return false;
+        }
+        value = items_.back();
+        items_.pop_back();
+        return true;
+    }
 
-            auto real_input = (prefix << window_shifts) | test_input;
-            if (window_shifts == expected_wnd_shifts) {
-                uint8_t actual_bits;
-                uint64_t actual_output;
-                unpack(run_ex(program, real_input), actual_bits, actual_output);
-                if (target_output == actual_output && actual_bits == target_bit_count) {
-                    results.insert(real_input);
+    bool steal(wide_t &value) {
+        std::lock_guard lock(mutex_);
+        if (items_.empty()) {
+            return false;
+        }
+        value = items_.front();
+        items_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex_{};
+    std::deque<wide_t> items_{};
+};
+
+// `reverse_search` on `thread_count` workers, one level (loop iteration) at a time. Each level is dealt out to the
+// workers' deques, and a worker that runs dry steals from the others. Children go to per-worker buffers, which the
+// barrier merges, sorts and de-duplicates into the next level. Returns the sorted answers.
+std::vector<wide_t> parallel_reverse_search(const Jixun::AoC2024D17::Simulation::Program &program,
+                                            const Jixun::AoC2024D17::Simulation::LoopShape &shape,
+                                            const std::span<const uint8_t> target, const size_t thread_count,
+                                            const OutputTable *table = nullptr) {
+    const auto iterations = iteration_count(shape, target.size());
+    if (iterations == 0 || thread_count <= 1) {
+        const auto found = reverse_search(program, shape, target, table);
+        std::vector<wide_t> results(found.cbegin(), found.cend());
+        std::ranges::sort(results);
+        return results;
+    }
+
+    std::vector<WorkDeque> deques(thread_count);
+    std::vector<std::vector<wide_t> > children(thread_count);
+    std::vector<std::vector<wide_t> > found(thread_count);
+    std::vector<wide_t> complete{};
+    size_t level{0};
+    bool done{false};
+
+    auto deal = [&](const std::vector<wide_t> &values) {
+        for (size_t i = 0; i < values.size(); i++) {
+            deques[i % thread_count].push(values[i]);
+        }
+    };
+    deal({0});
+
+    // Runs on one thread once every worker has drained the current level.
+    auto next_level = [&]() noexcept {
+        std::vector<wide_t> values{};
+        for (auto &items: children) {
+            values.insert(values.end(), items.cbegin(), items.cend());
+            items.clear();
+        }
+        std::ranges::sort(values);
+        values.erase(std::ranges::unique(values).begin(), values.end());
+
+        if (++level == iterations) {
+            complete = std::move(values);
+            done = true;
+            return;
+        }
+        deal(values);
+        done = values.empty();
+    };
+    std::barrier sync(static_cast<std::ptrdiff_t>(thread_count), next_level);
+
+    auto worker = [&](const size_t id) {
+        auto take = [&](wide_t &value) {
+            if (deques[id].pop(value)) {
+                return true;
+            }
+            for (size_t i = 1; i < thread_count; i++) {
+                if (deques[(id + i) % thread_count].steal(value)) {
+                    return true;
                 }
-            } else if (window_shifts < expected_wnd_shifts) {
-                work.emplace_back(pack(window_shifts + 3, real_input));
             }
+            return false;
+        };
+
+        while (!done) {
+            const auto expected = expected_digits(shape, target, level);
+            wide_t known;
+            while (take(known)) {
+                scan_window(program, shape, table, level, iterations, known, expected, [&](const wide_t value) {
+                    children[id].push_back(value);
+                });
+            }
+            sync.arrive_and_wait();
         }
+
+        // `complete` is sorted, so each worker verifies one contiguous slice.
+        const size_t slice = (complete.size() + thread_count - 1) / thread_count;
+        const size_t begin = std::min(complete.size(), id * slice);
+        const size_t end = std::min(complete.size(), begin + slice);
+        verify_candidates(program, std::span(complete).subspan(begin, end - begin), target,
+                          [&](const wide_t value) { found[id].push_back(value); });
+    };
+
+    std::vector<std::thread> workers{};
+    for (size_t id = 1; id < thread_count; id++) {
+        workers.emplace_back(worker, id);
+    }
+    worker(0);
+    for (auto &thread: workers) {
+        thread.join();
     }
 
+    // Slices are sorted and disjoint, so concatenating them in order keeps the answers sorted.
+    std::vector<wide_t> results{};
+    for (const auto &items: found) {
+        results.insert(results.end(), items.cbegin(), items.cend());
+    }
     return results;
 }
 
-std::vector<uint64_t> extract_digits(const std::string &input) {
-    const std::regex re(R"(\d+)");
-    const std::sregex_iterator begin(input.begin(), input.end(), re);
-    const std::sregex_iterator end;
-    std::vector<uint64_t> result{};
+// Brute-force scan of every A in [lo, hi] for the ones that output `target`, for programs `reverse_search` can not
+// handle. Workers take `kChunk` values at a time and stop each run at its first wrong digit. Progress goes to stderr
+// every second. With a checkpoint file, the scanned prefix of the range and the matches so far are saved with it,
+// and a later scan of the same program and range resumes from there.
+class RangeScan {
+public:
+    static constexpr uint64_t kChunk = 1 << 20;
+
+    RangeScan(const Jixun::AoC2024D17::Simulation::Program &program, const std::span<const uint8_t> target,
+              const uint64_t lo, const uint64_t hi, std::string checkpoint_path)
+        : program_(program), target_(target), lo_(lo), hi_(hi), chunks_((hi - lo) / kChunk + 1),
+          checkpoint_path_(std::move(checkpoint_path)) {
+    }
+
+    // Loads the checkpoint, if there is one. False when it belongs to another program or range, or can not be read.
+    bool resume() {
+        if (checkpoint_path_.empty()) {
+            return true;
+        }
+        std::ifstream ifs(checkpoint_path_);
+        if (!ifs.is_open()) {
+            return true; // first run
+        }
+        uint64_t lo, hi, scanned_chunks;
+        std::string program;
+        if (!(ifs >> lo >> hi >> scanned_chunks >> program) || lo != lo_ || hi != hi_ ||
+            scanned_chunks > chunks_ || program != program_key()) {
+            return false;
+        }
+        for (uint64_t value; ifs >> value;) {
+            matches_.push_back(value);
+        }
+        watermark_ = scanned_chunks;
+        return true;
+    }
+
+    // Scans the rest of the range on `thread_count` workers, returns every match in order.
+    std::vector<uint64_t> run(const size_t thread_count) {
+        const auto workers_count = std::max<size_t>(thread_count, 1);
+        next_chunk_ = watermark_;
+        const auto start_chunk = watermark_;
+        running_ = workers_count;
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers{};
+        for (size_t i = 0; i < workers_count; i++) {
+            workers.emplace_back([this] { worker(); });
+        }
+
+        for (bool finished = false; !finished;) {
+            {
+                std::unique_lock lock(mutex_);
+                finished = done_.wait_for(lock, std::chrono::seconds(1), [this] { return running_ == 0; });
+            }
+            const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            report(seconds, start_chunk);
+            save_checkpoint();
+        }
+
+        for (auto &thread: workers) {
+            thread.join();
+        }
+
+        std::vector<uint64_t> results = matches_;
+        std::ranges::sort(results);
+        results.erase(std::ranges::unique(results).begin(), results.end());
+        return results;
+    }
+
+private:
+    void worker() {
+        for (uint64_t chunk; (chunk = next_chunk_.fetch_add(1)) < chunks_;) {
+            const uint64_t begin = lo_ + chunk * kChunk;
+            const uint64_t end = chunk + 1 == chunks_ ? hi_ : begin + kChunk - 1;
+            std::vector<uint64_t> found{};
+            for (uint64_t a = begin;; a++) {
+                if (program_.run_matches(a, target_)) {
+                    found.push_back(a);
+                }
+                if (a == end) {
+                    break;
+                }
+            }
+            scanned_ += end - begin + 1;
+
+            std::lock_guard lock(mutex_);
+            matches_.insert(matches_.end(), found.cbegin(), found.cend());
+            // Chunks finish out of order, the checkpoint only covers the ones finished without a gap.
+            completed_.insert(chunk);
+            while (completed_.contains(watermark_)) {
+                completed_.erase(watermark_++);
+            }
+        }
+
+        std::lock_guard lock(mutex_);
+        if (--running_ == 0) {
+            done_.notify_all();
+        }
+    }
+
+    void report(const double seconds, const uint64_t start_chunk) const {
+        const auto total = static_cast<double>(hi_ - lo_) + 1;
+        const auto resumed = static_cast<double>(std::min(start_chunk * kChunk, hi_ - lo_ + 1));
+        const auto scanned = static_cast<double>(scanned_.load());
+        size_t match_count;
+        {
+            std::lock_guard lock(mutex_);
+            match_count = matches_.size();
+        }
+        fprintf(stderr, "scan: %.2f%% of %.0f, %zu matches, %.0f/s\n", (resumed + scanned) * 100 / total, total,
+                match_count, seconds > 0 ? scanned / seconds : 0);
+    }
+
+    // The scanned program, as one token for the checkpoint header: its digits, comma separated.
+    [[nodiscard]] std::string program_key() const {
+        std::string key{};
+        for (const auto digit: target_) {
+            if (!key.empty()) {
+                key.push_back(',');
+            }
+            key.push_back(static_cast<char>('0' + digit));
+        }
+        return key;
+    }
+
+    // Written to a temporary file first, so an interrupted or failed save keeps the previous checkpoint.
+    void save_checkpoint() const {
+        if (checkpoint_path_.empty()) {
+            return;
+        }
+        const auto temp_path = checkpoint_path_ + ".tmp";
+        bool written;
+        {
+            std::ofstream ofs(temp_path, std::ios::trunc);
+            std::lock_guard lock(mutex_);
+            ofs << lo_ << ' ' << hi_ << ' ' << watermark_ << ' ' << program_key() << '\n';
+            for (const auto value: matches_) {
+                ofs << value << '\n';
+            }
+            ofs.close();
+            written = !ofs.fail();
+        }
+        if (!written) {
+            fprintf(stderr, "scan: unable to write checkpoint %s, keeping the previous one\n", temp_path.c_str());
+            return;
+        }
+        std::rename(temp_path.c_str(), checkpoint_path_.c_str());
+    }
+
+    const Jixun::AoC2024D17::Simulation::Program &program_;
+    std::span<const uint8_t> target_;
+    uint64_t lo_;
+    uint64_t hi_;
+    uint64_t chunks_;
+    std::string checkpoint_path_{};
+
+    std::atomic<uint64_t> next_chunk_{0};
+    std::atomic<uint64_t> scanned_{0};
+
+    mutable std::mutex mutex_{};
+    std::condition_variable done_{};
+    size_t running_{0};
+    uint64_t watermark_{0}; // chunks below this one are all scanned
+    std::set<uint64_t> completed_{}; // chunks scanned at or above `watermark_`
+    std::vector<uint64_t> matches_{}; // may repeat matches of chunks redone after a resume
+};
+
+// Every number in the input, wide enough for registers beyond 64 bits.
+std::vector<wide_t> extract_digits(const std::string &input) {
+    std::vector<wide_t> result{};
     result.reserve(input.length() / 4);
-    for (auto it = begin; it != end; ++it) {
-        result.push_back(std::stoull(it->str()));
+    bool in_number = false;
+    for (const char c: input) {
+        if (c >= '0' && c <= '9') {
+            if (!in_number) {
+                result.push_back(0);
+                in_number = true;
+            }
+            result.back() = result.back() * 10 + static_cast<wide_t>(c - '0');
+        } else {
+            in_number = false;
+        }
     }
     return result;
 }
 
+template<typename T>
+double time_ms(T &&callback) {
+    const auto start = std::chrono::steady_clock::now();
+    callback();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void run_benchmark(const std::span<const uint8_t> program_bytes, const size_t max_threads, const bool aot) {
+    using namespace Jixun::AoC2024D17::Simulation;
+    const Program program(program_bytes);
+
+    // Random A values up to 48 bits, the size of a 16 digit answer.
+    constexpr size_t kRuns = 1 << 20;
+    std::mt19937_64 rng(17);
+    std::vector<uint64_t> inputs(kRuns);
+    for (auto &input: inputs) {
+        input = rng() >> 16;
+    }
+
+    uint64_t instructions{0};
+    for (const auto input: inputs) {
+        (void) program.run_counted(input, 0, 0, instructions);
+    }
+
+    uint64_t switch_sum{0}, threaded_sum{0};
+    const auto switch_ms = time_ms([&] {
+        for (const auto input: inputs) {
+            switch_sum += run_ex(program_bytes, input);
+        }
+    });
+    const auto threaded_ms = time_ms([&] {
+        for (const auto input: inputs) {
+            threaded_sum += program.run_ex(input);
+        }
+    });
+
+    uint64_t lanes_sum{0};
+    const auto lanes_ms = time_ms([&] {
+        for (size_t i = 0; i < kRuns; i += kLanes) {
+            std::array<uint64_t, kLanes> candidates{};
+            std::copy_n(inputs.begin() + static_cast<std::ptrdiff_t>(i), kLanes, candidates.begin());
+            for (const auto packed: program.run_ex_lanes(candidates)) {
+                lanes_sum += packed;
+            }
+        }
+    });
+
+    // The same runs on 128-bit registers, into a digit buffer.
+    uint64_t wide_sum{0};
+    std::vector<uint8_t> digits{};
+    const auto wide_ms = time_ms([&] {
+        for (const auto input: inputs) {
+            digits.clear();
+            (void) program.run_digits(input, 0, 0, digits);
+            uint64_t result{0};
+            for (size_t i = 0; i < digits.size() && i < kPackedDigits; i++) {
+                result |= static_cast<uint64_t>(digits[i]) << (i * 3);
+            }
+            wide_sum += pack(static_cast<uint8_t>(digits.size() * 3), result);
+        }
+    });
+
+    printf("bench: %zu runs, %" PRIu64 " instructions; switch=%.3fms (%.2fns/inst), threaded=%.3fms (%.2fns/inst), "
+           "results %s\n", kRuns, instructions, switch_ms, switch_ms * 1e6 / static_cast<double>(instructions),
+           threaded_ms, threaded_ms * 1e6 / static_cast<double>(instructions),
+           switch_sum == threaded_sum ? "ok" : "MISMATCH");
+    printf("bench: %zu lanes=%.3fms (%.2fns/inst), results %s\n", kLanes, lanes_ms,
+           lanes_ms * 1e6 / static_cast<double>(instructions), lanes_sum == threaded_sum ? "ok" : "MISMATCH");
+    printf("bench: wide=%.3fms (%.2fns/inst), results %s\n", wide_ms,
+           wide_ms * 1e6 / static_cast<double>(instructions), wide_sum == threaded_sum ? "ok" : "MISMATCH");
+
+    NativeProgram native{};
+    Program native_program(program_bytes);
+    if (std::string error; !aot) {
+        printf("bench: native skipped, use --aot\n");
+    } else if (!native.compile(program_bytes, error)) {
+        printf("bench: native skipped, %s\n", error.c_str());
+    } else {
+        native_program.attach_native(native.run_ex());
+        uint64_t native_sum{0};
+        const auto native_ms = time_ms([&] {
+            for (const auto input: inputs) {
+                native_sum += native_program.run_ex(input);
+            }
+        });
+        printf("bench: native=%.3fms (%.2fns/inst), results %s\n", native_ms,
+               native_ms * 1e6 / static_cast<double>(instructions), native_sum == threaded_sum ? "ok" : "MISMATCH");
+    }
+
+    const auto shape = program.analyse();
+    if (!shape.error.empty()) {
+        printf("bench: reverse_search skipped, unsupported program: %s\n", shape.error.c_str());
+        return;
+    }
+
+    std::unordered_set<wide_t, WideHash> serial_results{};
+    const auto search_ms = time_ms([&] {
+        serial_results = reverse_search(program, shape, program_bytes);
+    });
+    printf("bench: reverse_search=%.3fms, %zu results\n", search_ms, serial_results.size());
+    std::vector<wide_t> sorted_results(serial_results.cbegin(), serial_results.cend());
+    std::ranges::sort(sorted_results);
+
+    for (size_t thread_count = 2; thread_count <= max_threads; thread_count *= 2) {
+        std::vector<wide_t> parallel_results{};
+        const auto parallel_ms = time_ms([&] {
+            parallel_results = parallel_reverse_search(program, shape, program_bytes, thread_count);
+        });
+        printf("bench: parallel_reverse_search(%zu)=%.3fms, results %s\n", thread_count, parallel_ms,
+               parallel_results == sorted_results ? "ok" : "MISMATCH");
+    }
+
+    if (native.run_ex() != nullptr) {
+        std::unordered_set<wide_t, WideHash> native_results{};
+        const auto native_search_ms = time_ms([&] {
+            native_results = reverse_search(native_program, shape, program_bytes);
+        });
+        printf("bench: native reverse_search=%.3fms, results %s\n", native_search_ms,
+               native_results == serial_results ? "ok" : "MISMATCH");
+    }
+
+    if (shape.window > OutputTable::kMaxWindow) {
+        printf("bench: table skipped, window of %" PRIu64 " bits\n", shape.window);
+        return;
+    }
+    std::unordered_set<wide_t, WideHash> table_results{};
+    const auto table_ms = time_ms([&] {
+        const OutputTable table(program, shape);
+        table_results = reverse_search(program, shape, program_bytes, &table);
+    });
+    printf("bench: table(%" PRIu64 " bits) + reverse_search=%.3fms, results %s\n", shape.window, table_ms,
+           table_results == serial_results ? "ok" : "MISMATCH");
+}
+
+// Part 2 of known programs, through every search mode. Returns false when any of them gives a wrong answer.
+bool run_tests() {
+    using namespace Jixun::AoC2024D17::Simulation;
+    struct test_t {
+        std::vector<uint8_t> program;
+        wide_t expected;
+    };
+    const std::vector<test_t> tests = {
+        {{0, 3, 5, 4, 3, 0}, 117440}, // puzzle example
+        {{2, 4, 1, 5, 7, 5, 0, 3, 4, 0, 1, 6, 5, 5, 3, 0}, 109019476330651},
+        // Window narrower than the shift: bits between windows are never read.
+        {{2, 4, 5, 5, 0, 3, 0, 1, 3, 0}, 562912318786}, // sample2.txt
+        {{2, 4, 5, 5, 0, 3, 0, 3, 3, 0}, 144972810368078082}, // sample3.txt
+    };
+
+    bool all_ok = true;
+    for (const auto &[bytes, expected]: tests) {
+        const Program program(bytes);
+        const auto shape = program.analyse();
+        std::string name{};
+        for (const auto b: bytes) {
+            name += (name.empty() ? "" : ",") + std::to_string(b);
+        }
+        if (!shape.error.empty()) {
+            printf("test: %s: unsupported, %s\n", name.c_str(), shape.error.c_str());
+            all_ok = false;
+            continue;
+        }
+
+        const OutputTable table(program, shape);
+        for (const auto *mode_table: {static_cast<const OutputTable *>(nullptr), &table}) {
+            for (const size_t thread_count: {1, 3}) {
+                const auto results = parallel_reverse_search(program, shape, bytes, thread_count, mode_table);
+                const bool ok = !results.empty() && results[0] == expected;
+                printf("test: %s, threads %zu%s: %s\n", name.c_str(), thread_count, mode_table ? ", table" : "",
+                       ok ? "ok" : "MISMATCH");
+                all_ok &= ok;
+            }
+        }
+    }
+    return all_ok;
+}
+
 int main(const int argc, char **argv) {
-    const char *input_file_path = argc > 1 ? argv[1] : "sample.txt";
+    bool bench = false;
+    bool use_table = false;
+    bool aot = false;
+    bool scan = false;
+    uint64_t scan_lo{0}, scan_hi{0};
+    std::string checkpoint_path{};
+    size_t thread_count = std::thread::hardware_concurrency();
+    const char *input_file_path = "sample.txt";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--test") == 0) {
+            return run_tests() ? 0 : 1;
+        } else if (strcmp(argv[i], "--scan") == 0 && i + 2 < argc) {
+            scan = true;
+            scan_lo = std::stoull(argv[++i], nullptr, 0);
+            scan_hi = std::stoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if (strcmp(argv[i], "--aot") == 0) {
+            aot = true;
+        } else if (strcmp(argv[i], "--table") == 0) {
+            use_table = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = std::stoull(argv[++i]);
+        } else {
+            input_file_path = argv[i];
+        }
+    }
+
     std::ifstream ifs(input_file_path);
     if (!ifs.is_open()) {
         printf("error: unable to open file %s\n", input_file_path);
@@ -210,25 +1700,56 @@ int main(const int argc, char **argv) {
     auto numbers = extract_digits(input);
 
     std::vector<uint8_t> program(numbers.size() - 3);
-    std::copy(numbers.cbegin() + 3, numbers.cend(), program.begin());
+    std::ranges::transform(numbers.cbegin() + 3, numbers.cend(), program.begin(), [](const wide_t value) {
+        return static_cast<uint8_t>(value);
+    });
+    Jixun::AoC2024D17::Simulation::Program decoded(program);
+    Jixun::AoC2024D17::Simulation::NativeProgram native{};
+    if (std::string error; aot && !bench) {
+        if (native.compile(program, error)) {
+            decoded.attach_native(native.run_ex());
+        } else {
+            fprintf(stderr, "aot: %s, using the interpreter\n", error.c_str());
+        }
+    }
 
     // p1
     {
-        using Jixun::AoC2024D17::Simulation::run_ex;
-        uint8_t bits;
-        uint64_t p1_result;
-        unpack(run_ex(program, numbers[0], numbers[1], numbers[2]), bits, p1_result);
+        std::vector<uint8_t> digits{};
+        bool valid;
+        if (native.run_ex() != nullptr && std::ranges::all_of(numbers.cbegin(), numbers.cbegin() + 3,
+                                                               [](const wide_t value) { return value >> 64 == 0; })) {
+            // The compiled program packs up to `kPackedDigits` digits and saturates the bit count. Longer output,
+            // and the invalid-program result (which also reads as 0xFF bits), run again on the interpreter.
+            uint8_t bits;
+            uint64_t p1_result;
+            unpack(decoded.run_ex(static_cast<uint64_t>(numbers[0]), static_cast<uint64_t>(numbers[1]),
+                                  static_cast<uint64_t>(numbers[2])), bits, p1_result);
+            if (bits <= kPackedDigits * 3) {
+                valid = true;
+                for (uint8_t i = 0; i < bits; i += 3) {
+                    digits.push_back(static_cast<uint8_t>(p1_result >> i & 7));
+                }
+            } else {
+                valid = decoded.run_digits(numbers[0], numbers[1], numbers[2], digits);
+            }
+        } else {
+            valid = decoded.run_digits(numbers[0], numbers[1], numbers[2], digits);
+        }
+        if (!valid) {
+            printf("error: invalid instruction\n");
+            return 1;
+        }
 
 #ifndef NDEBUG
-        std::cout << "simulation: 0o" << std::setfill('0') << std::setw(bits / 3) << std::oct << numbers[0] << " -> 0o"
-                << std::setfill('0') << std::setw(bits / 3) << std::oct << p1_result << std::endl;
+        std::cout << "simulation: 0o" << to_string(numbers[0], 8) << " -> " << digits.size() << " digits"
+                << std::endl;
 #endif
 
         char comma = ' ';
         printf("p1:");
-        for (uint8_t i = 0; i < bits; i += 3) {
-            printf("%c%o", comma, static_cast<int>(p1_result % 8));
-            p1_result >>= 3;
+        for (const auto digit: digits) {
+            printf("%c%o", comma, static_cast<int>(digit));
             comma = ',';
         }
         printf("\n");
@@ -236,24 +1757,60 @@ int main(const int argc, char **argv) {
 
     // p2
     {
-        uint64_t expected_value{0};
-        int expected_bits{0};
-        for (const auto &b: program) {
-            expected_value |= static_cast<uint64_t>(b) << expected_bits;
-            expected_bits += 3;
+        if (bench) {
+            run_benchmark(program, thread_count, aot);
+            return 0;
+        }
+
+        if (scan) {
+            if (scan_lo > scan_hi || scan_hi == UINT64_MAX) {
+                printf("error: invalid scan range\n");
+                return 1;
+            }
+            RangeScan range_scan(decoded, program, scan_lo, scan_hi, checkpoint_path);
+            if (!range_scan.resume()) {
+                printf("error: checkpoint %s is not for this program and range\n", checkpoint_path.c_str());
+                return 1;
+            }
+            const auto matches = range_scan.run(thread_count);
+            for (const auto value: matches) {
+                printf("scan: %" PRIu64 "\n", value);
+            }
+            if (!matches.empty()) {
+                printf("p2: %" PRIu64 "\n", matches[0]);
+            } else {
+                printf("p2: no solution found in range!\n");
+            }
+            return 0;
+        }
+
+        const auto shape = decoded.analyse();
+        if (!shape.error.empty()) {
+            printf("error: unsupported program for p2: %s\n", shape.error.c_str());
+            return 1;
+        }
+        if (shape.shift * iteration_count(shape, program.size()) > 128) {
+            printf("error: unsupported program for p2: answers need more than 128 bits\n");
+            return 1;
         }
 
 #ifndef NDEBUG
-        std::cout << "reverse search: 0o" << std::setfill('0') << std::setw(expected_bits / 3) << std::oct
-                << expected_value << std::endl;
+        std::cout << "loop: A >>= " << std::dec << shape.shift << ", " << shape.outputs << " output(s), window "
+                << shape.window << " bits" << std::endl;
 #endif
 
-        if (auto r = reverse_search(program, expected_value, expected_bits); !r.empty()) {
-            auto sorted_results = std::vector(r.cbegin(), r.cend());
-            std::ranges::sort(sorted_results);
-            std::cout << "p2: " << std::dec << sorted_results[0]
+        // Windows too wide for a table fall back to running the program.
+        std::optional<OutputTable> table{};
+        if (use_table && shape.window <= OutputTable::kMaxWindow) {
+            table.emplace(decoded, shape);
+        }
+
+        if (const auto sorted_results = parallel_reverse_search(decoded, shape, program, thread_count,
+                                                                table ? &*table : nullptr);
+            !sorted_results.empty()) {
+            std::cout << "p2: " << to_string(sorted_results[0])
 #ifndef NDEBUG
-                    << " (total " << sorted_results.size() << " results)"
+                    << " (total " << std::dec << sorted_results.size() << " results)"
 #endif
                     << std::endl;
         } else {
@@ -1,10 +1,14 @@
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <cinttypes>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <optional>
+#include <random>
 #include <sstream>
 #include <vector>
 
@@ -27,6 +31,93 @@ inline uint32_t derive_secret(uint32_t secret) {
     return secret;
 }
 
+// `derive_secret` only xors shifted copies of the secret together and masks to 24 bits, so it is a linear map over
+// GF(2)^24. `columns[i]` is the image of bit `i`: applying the matrix xors together the columns of the set bits.
+struct SecretMatrix {
+    std::array<uint32_t, 24> columns{};
+
+    static SecretMatrix identity() {
+        SecretMatrix result{};
+        for (size_t i = 0; i < 24; i++) {
+            result.columns[i] = 1u << i;
+        }
+        return result;
+    }
+
+    // One `derive_secret` step.
+    static SecretMatrix step() {
+        SecretMatrix result{};
+        for (size_t i = 0; i < 24; i++) {
+            result.columns[i] = derive_secret(1u << i);
+        }
+        return result;
+    }
+
+    // `step()` applied `n` times, from the precomputed squarings step^(2^k).
+    static SecretMatrix power(uint64_t n) {
+        static const auto kPowers = [] {
+            std::array<SecretMatrix, 64> powers{};
+            powers[0] = step();
+            for (size_t k = 1; k < powers.size(); k++) {
+                powers[k] = powers[k - 1] * powers[k - 1];
+            }
+            return powers;
+        }();
+
+        auto result = identity();
+        for (size_t k = 0; n != 0; k++, n >>= 1) {
+            if (n & 1) {
+                result = kPowers[k] * result;
+            }
+        }
+        return result;
+    }
+
+    [[nodiscard]] uint32_t apply(const uint32_t secret) const {
+        uint32_t result{0};
+        for (size_t i = 0; i < 24; i++) {
+            if (secret >> i & 1) {
+                result ^= columns[i];
+            }
+        }
+        return result;
+    }
+
+    // `other` first, then this one.
+    SecretMatrix operator*(const SecretMatrix &other) const {
+        SecretMatrix result{};
+        for (size_t i = 0; i < 24; i++) {
+            result.columns[i] = apply(other.columns[i]);
+        }
+        return result;
+    }
+};
+
+// The secret after a fixed number of steps, for any number of buyers: `SecretMatrix::power(steps)` split into one
+// 256-entry table per input byte, so each buyer costs 3 lookups.
+class SecretJump {
+public:
+    explicit SecretJump(const uint64_t steps) : steps_(steps) {
+        const auto matrix = SecretMatrix::power(steps);
+        for (size_t byte = 0; byte < 3; byte++) {
+            for (uint32_t value = 0; value < 256; value++) {
+                tables_[byte][value] = matrix.apply(value << (8 * byte));
+            }
+        }
+    }
+
+    uint32_t operator()(const uint32_t secret) const {
+        if (steps_ == 0) {
+            return secret;
+        }
+        return tables_[0][secret & 0xFF] ^ tables_[1][secret >> 8 & 0xFF] ^ tables_[2][secret >> 16 & 0xFF];
+    }
+
+private:
+    uint64_t steps_;
+    std::array<std::array<uint32_t, 256>, 3> tables_{};
+};
+
 constexpr size_t kPatternSize = 1 << 20;
 constexpr uint32_t kPatternSizeMask = kPatternSize - 1;
 
@@ -52,8 +143,76 @@ inline uint32_t derive_secret_at(uint8_t *patterns, const uint32_t seed, const s
     return secret;
 }
 
+template<typename T>
+double time_ms(T &&callback) {
+    const auto start = std::chrono::steady_clock::now();
+    callback();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void run_benchmark(const std::vector<uint32_t> &initial_secrets) {
+    uint64_t iterated{0}, jumped{0};
+    const auto iterate_ms = time_ms([&] {
+        for (auto secret: initial_secrets) {
+            for (int i = 0; i < 2000; i++) {
+                secret = derive_secret(secret);
+            }
+            iterated += secret;
+        }
+    });
+    const auto jump_ms = time_ms([&] {
+        const SecretJump jump(2000);
+        for (const auto secret: initial_secrets) {
+            jumped += jump(secret);
+        }
+    });
+    printf("bench: %zu buyers, 2000 steps; iterate=%.3fms, jump=%.3fms, results %s\n", initial_secrets.size(),
+           iterate_ms, jump_ms, iterated == jumped ? "ok" : "MISMATCH");
+
+    // Far jumps: the cost no longer depends on the step count.
+    constexpr size_t kBuyers = 1 << 22;
+    constexpr uint64_t kSteps = 1'000'000'000'000;
+    std::mt19937 rng(22);
+    std::vector<uint32_t> buyers(kBuyers);
+    for (auto &buyer: buyers) {
+        buyer = rng() & 0xFF'FFFF;
+    }
+    uint64_t far_sum{0};
+    std::optional<SecretJump> far_jump{};
+    const auto far_ms = time_ms([&] {
+        far_jump.emplace(kSteps);
+        for (const auto secret: buyers) {
+            far_sum += (*far_jump)(secret);
+        }
+    });
+
+    // Spot check against the plain matrix, its powers are checked against iteration above.
+    bool far_ok = true;
+    const auto matrix = SecretMatrix::power(kSteps);
+    for (size_t i = 0; i < 1000; i++) {
+        far_ok &= (*far_jump)(buyers[i]) == matrix.apply(buyers[i]);
+    }
+    printf("bench: %zu buyers, %" PRIu64 " steps; jump=%.3fms (sum %" PRIu64 "), results %s\n", kBuyers, kSteps,
+           far_ms, far_sum, far_ok ? "ok" : "MISMATCH");
+}
+
 int main(const int argc, char **argv) {
-    const char *input_file_path = argc > 1 ? argv[1] : "sample.txt";
+    bool bench = false;
+    bool p1_only = false;
+    uint64_t steps{2000};
+    const char *input_file_path = "sample.txt";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            p1_only = true;
+            steps = std::stoull(argv[++i]);
+        } else {
+            input_file_path = argv[i];
+        }
+    }
+
     std::ifstream ifs(input_file_path);
     if (!ifs.is_open()) {
         printf("error: unable to open file %s\n", input_file_path);
@@ -68,6 +227,21 @@ int main(const int argc, char **argv) {
     uint64_t p1{0};
     const auto initial_secrets = extract_code(input);
 
+    if (bench) {
+        run_benchmark(initial_secrets);
+        return 0;
+    }
+
+    // p1 only, for any number of steps, without the p2 price scan.
+    if (p1_only) {
+        const SecretJump jump(steps);
+        for (const auto initial_secret: initial_secrets) {
+            p1 += jump(initial_secret);
+        }
+        printf("p1 (%" PRIu64 " steps): %" PRIu64 "\n", steps, p1);
+        return 0;
+    }
+
     std::vector<uint32_t> sums_container(kPatternSize);
     auto* sums = sums_container.data();
 